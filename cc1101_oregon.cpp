@@ -14,11 +14,10 @@
  */
 
 #include "cc1101_oregon.h"
+#include "oregon_symbols.h"
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
-#include <wiringPi.h>
-#include <wiringPiSPI.h>
 
 
 static uint8_t cc1101_OOK_Oregon[CFG_REGISTER] = {
@@ -80,13 +79,13 @@ static uint8_t patable_power_433[8] = {0x6C,0x1C,0x06,0x3A,0x51,0x85,0xC8,0xC0};
 //-------------------------[CC1101 reset function]------------------------------
 void CC1101_Oregon::reset(void)                  // reset defined in cc1101 datasheet
 {
-    digitalWrite(SS_PIN, LOW);
-    delayMicroseconds(10);
-    digitalWrite(SS_PIN, HIGH);
-    delayMicroseconds(40);
+    transport->pin_write(SS_PIN, 0);
+    transport->delay_us(10);
+    transport->pin_write(SS_PIN, 1);
+    transport->delay_us(40);
 
     spi_write_strobe(SRES);
-    delay(1);
+    transport->delay_ms(1);
 }
 //-----------------------------[END]--------------------------------------------
 
@@ -101,10 +100,11 @@ void CC1101_Oregon::powerdown(void)
 //---------------------------[WakeUp]-------------------------------------------
 void CC1101_Oregon::wakeup(void)
 {
-    digitalWrite(SS_PIN, LOW);
-    delayMicroseconds(10);
-    digitalWrite(SS_PIN, HIGH);
-    delayMicroseconds(10);
+    transport->pin_write(SS_PIN, 0);
+    transport->delay_us(10);
+    transport->pin_write(SS_PIN, 1);
+    transport->delay_us(10);
+    spi_write_burst(FSTEST, &cc1101_OOK_Oregon[FSTEST], TEST0 - FSTEST + 1); // test settings are lost in SLEEP
     receive();                            // go to RX Mode
 }
 //-----------------------------[end]--------------------------------------------
@@ -130,8 +130,8 @@ uint8_t CC1101_Oregon::begin(uint8_t debug_level)
 {
     uint8_t partnum, version;
 
-//    pinMode(GDO0, INPUT);                 //setup AVR GPIO ports
-    pinMode(GDO2, INPUT);
+//    transport->pin_input(GDO0);                 //setup AVR GPIO ports
+    transport->pin_input(GDO2);
 
     set_debug_level(debug_level);   //set debug level of CC1101 outputs
 
@@ -142,8 +142,8 @@ uint8_t CC1101_Oregon::begin(uint8_t debug_level)
     spi_begin();                          //inits SPI Interface
     reset();                              //CC1101 init reset
 
-    spi_write_strobe(SFTX);delayMicroseconds(100);//flush the TX_fifo content
-    spi_write_strobe(SFRX);delayMicroseconds(100);//flush the RX_fifo content
+    spi_write_strobe(SFTX);transport->delay_us(100);//flush the TX_fifo content
+    spi_write_strobe(SFRX);transport->delay_us(100);//flush the RX_fifo content
 
     partnum = spi_read_register(PARTNUM); //reads CC1101 partnumber
     version = spi_read_register(HW_VERSION); //reads CC1101 version number
@@ -181,6 +181,7 @@ uint8_t CC1101_Oregon::begin(uint8_t debug_level)
 //-----------------[finish's the CC1101 operation]------------------------------
 void CC1101_Oregon::end(void)
 {
+    transport->gdo2_events_end();
     powerdown();                          //power down CC1101
 }
 //-------------------------------[end]------------------------------------------
@@ -238,7 +239,7 @@ uint8_t CC1101_Oregon::sidle(void)
     {
         marcstate = (spi_read_register(MARCSTATE) & 0x1F); //read out state of cc1101 to be sure in RX
     }
-    delayMicroseconds(100);
+    transport->delay_us(100);
     return TRUE;
 }
 //-------------------------------[end]------------------------------------------
@@ -258,31 +259,48 @@ uint8_t CC1101_Oregon::receive(void)
     {
         marcstate = (spi_read_register(MARCSTATE) & 0x1F); //read out state of cc1101 to be sure in RX
     }
-    delayMicroseconds(100);
+    transport->delay_us(100);
     return TRUE;
 }
 //-------------------------------[end]------------------------------------------
 
-//------------[enables WOR Mode  EVENT0 ~1890ms; rx_timeout ~235ms]--------------------
-void CC1101_Oregon::wor_enable()
+//-------------------[enables WOR Mode for the Oregon bursts]-------------------
+uint32_t CC1101_Oregon::wor_enable(unsigned int repeat_ms)
 {
 /*
-    EVENT1 = WORCTRL[6:4] -> Datasheet page 88
-    EVENT0 = (750/Xtal)*(WOREVT1<<8+WOREVT0)*2^(5*WOR_RES) = (750/26Meg)*65407*2^(5*0) = 1.89s
+    A burst is caught if the radio gets to RX while enough of its preamble is left for the
+    sync word - a window of (64 - 16) bits, 23.5ms at 2046 Bd. EVENT0 may be up to twice that
+    when the second burst of a message comes half a period after the first one: whichever
+    half the first burst falls in, one of the two is caught. So
 
-                        (WOR_RES=0;RX_TIME=0)               -> Datasheet page 80
-i.E RX_TIMEOUT = EVENT0*       (3.6038)      *26/26Meg = 235.8ms
-                        (WOR_RES=0;RX_TIME=1)               -> Datasheet page 80
-i.E.RX_TIMEOUT = EVENT0*       (1.8029)      *26/26Meg = 117.9ms
+        EVENT0 = repeat / (n + 1/2), n the smallest one that fits in 2 windows (less a margin)
+        EVENT0 = (750/Xtal)*(WOREVT1<<8+WOREVT0)*2^(5*WOR_RES)  (WOR_RES=0)      -> Datasheet page 88
+
+    i.E. repeat = 250ms -> EVENT0 = 38.5ms. RX_TIMEOUT is at most 12.5% of EVENT0 (4.8ms),
+    short of the sync word (7.8ms) - so RX_TIME = until end of packet, and RX_TIME_RSSI ends
+    the RX after 8 symbols (3.9ms) without a carrier instead.
 */
+    uint32_t bit_ns, max_us, repeat_us, event0_us, worevt, n;
+
+    bit_ns = 1000000000 / data_rate();
+    max_us = 2 * (OREGON_PREAMBLE_RAW_BITS - OREGON_SYNC_RAW_BITS) * bit_ns / 1000 * (100 - WOR_MARGIN_PCT) / 100;
+    repeat_us = repeat_ms * 1000;
+    n = (2 * repeat_us + max_us - 1) / (2 * max_us);
+    event0_us = 2 * repeat_us / (2 * n + 1);
+    worevt = (uint64_t)event0_us * (CRYSTAL_FREQUENCY / 1000) / 750000;
+    if (worevt > 0xFFFF)
+        worevt = 0xFFFF;
+    wor_event0_us = (uint64_t)worevt * 750000 / (CRYSTAL_FREQUENCY / 1000);
+    wor_listen_us = (uint64_t)WOR_EVENT1_PERIODS * 750000 / (CRYSTAL_FREQUENCY / 1000) + WOR_CS_SYMBOLS * bit_ns / 1000;
+
     sidle();
 
     spi_write_register(MCSM0, 0x18);    //FS Autocalibration
-    spi_write_register(MCSM2, 0x01);    //MCSM2.RX_TIME = 1b
+    spi_write_register(MCSM2, WOR_MCSM2); //carrier sense, then RX until end of packet
 
     // configure EVENT0 time
-    spi_write_register(WOREVT1, 0xFF);  //High byte Event0 timeout
-    spi_write_register(WOREVT0, 0x7F);  //Low byte Event0 timeout
+    spi_write_register(WOREVT1, worevt >> 8);   //High byte Event0 timeout
+    spi_write_register(WOREVT0, worevt & 0xFF); //Low byte Event0 timeout
 
     // configure EVENT1 time
     spi_write_register(WORCTRL, 0x78);  //WOR_RES=0b; tEVENT1=0111b=48d -> 48*(750/26MHz)= 1.385ms
@@ -291,7 +309,8 @@ i.E.RX_TIMEOUT = EVENT0*       (1.8029)      *26/26Meg = 117.9ms
     spi_write_strobe(SWORRST);          //resets the WOR timer to the programmed Event 1
     spi_write_strobe(SWOR);             //put the radio in WOR mode when CSn is released
 
-    delayMicroseconds(100);
+    transport->delay_us(100);
+    return wor_event0_us;
 }
 //-------------------------------[end]------------------------------------------
 
@@ -307,12 +326,21 @@ void CC1101_Oregon::wor_disable()
 void CC1101_Oregon::wor_reset()
 {
     sidle();                            //go to IDLE
-    spi_write_register(MCSM2, 0x01);    //MCSM2.RX_TIME = 1b
+    spi_write_register(MCSM2, WOR_MCSM2); //carrier sense, then RX until end of packet
     spi_write_strobe(SFRX);             //flush RX buffer
     spi_write_strobe(SWORRST);          //resets the WOR timer to the programmed Event 1
     spi_write_strobe(SWOR);             //put the radio in WOR mode when CSn is released
 
-    delayMicroseconds(100);
+    transport->delay_us(100);
+}
+//-------------------------------[end]------------------------------------------
+
+//--------------------[data rate of the configuration]--------------------------
+uint32_t CC1101_Oregon::data_rate()
+{
+    // DRATE = (256+DRATE_M)*2^DRATE_E/2^28 * Xtal                          -> Datasheet page 35
+    return ((uint64_t)(256 + cc1101_OOK_Oregon[MDMCFG3]) << (cc1101_OOK_Oregon[MDMCFG4] & 0x0F)) *
+            CRYSTAL_FREQUENCY >> 28;
 }
 //-------------------------------[end]------------------------------------------
 
@@ -339,26 +367,58 @@ uint8_t CC1101_Oregon::tx_payload_burst(uint8_t my_addr, uint8_t rx_addr,
 //-------------------------------[end]------------------------------------------
 
 //------------------[rx_payload_burst - package received]-----------------------
+// The post-packet sequence goes out in up to three SPI transactions instead of
+// polling loops and 100 us sleeps: RXBYTES sizes the FIFO read, and SFRX/SRX
+// are only sent once MARCSTATE shows IDLE. Anything else takes the slow path.
 uint8_t CC1101_Oregon::rx_payload_burst(uint8_t rxbuffer[], uint8_t &pktlen)
 {
+    CC1101_SPI_Batch batch;
     uint8_t bytes_in_RXFIFO = 0;
-    uint8_t res = 0;
-
-    bytes_in_RXFIFO = spi_read_register(RXBYTES);              //reads the number of bytes in RXFIFO
-
-    if((bytes_in_RXFIFO & 0x7F) && !(bytes_in_RXFIFO & 0x80))  //if bytes in buffer and no RX Overflow
+    uint8_t expected = cc1101_OOK_Oregon[PKTLEN] + 2;         //fixed length + rssi and lqi
+    uint8_t marcstate, slow = TRUE;
+    uint8_t res = FALSE;
+    int seg_rxbytes, seg_fifo, seg_marcstate, seg_flushed;
+
+    // 1st transfer: how much is there, and IDLE (normally there already, MCSM1.RXOFF_MODE)
+    seg_rxbytes = batch.read_register(RXBYTES);                //number of bytes in RXFIFO
+    batch.strobe(SIDLE);                                       //set to IDLE
+    transport->spi_transfer(batch);
+    bytes_in_RXFIFO = batch.data(seg_rxbytes)[0];
+
+    // 2nd transfer: the FIFO as far as it is filled, and whether IDLE was reached
+    batch.clear();
+    pktlen = bytes_in_RXFIFO & 0x7F;
+    if (pktlen > expected)
+        pktlen = expected;
+    seg_fifo = (pktlen && !(bytes_in_RXFIFO & 0x80)) ? batch.read_burst(RXFIFO_BURST, pktlen) : -1;
+    seg_marcstate = batch.read_register(MARCSTATE);
+    transport->spi_transfer(batch);
+    if (seg_fifo >= 0)                                         //if bytes in buffer and no RX Overflow
     {
-        spi_read_burst(RXFIFO_BURST, rxbuffer, bytes_in_RXFIFO);
-        pktlen = bytes_in_RXFIFO;
+        memcpy(rxbuffer, batch.data(seg_fifo), pktlen);
         res = TRUE;
     }
-    else
+    marcstate = batch.data(seg_marcstate)[0] & 0x1F;
+
+    // 3rd transfer, only in IDLE (SFRX is not defined elsewhere): flush, check it, back to RX
+    if (marcstate == 0x01)
     {
-        res = FALSE;
+        batch.clear();
+        batch.strobe(SFRX);                                    //flush RX Buffer
+        seg_flushed = batch.read_register(RXBYTES);
+        batch.strobe(SRX);                                     //set to receive mode
+        seg_marcstate = batch.read_register(MARCSTATE);
+        transport->spi_transfer(batch);
+        // radio is calibrating on its way to RX - only a flush or strobe that did not take needs the slow path
+        marcstate = batch.data(seg_marcstate)[0] & 0x1F;
+        slow = batch.data(seg_flushed)[0] || marcstate == 0x01 || marcstate == 0x11; //FIFO not empty, IDLE or RXFIFO_OVERFLOW
+    }
+    if (slow)                                                  //also if IDLE was not reached above
+    {
+        sidle();
+        spi_write_strobe(SFRX);transport->delay_us(100);
+        receive();
     }
-    sidle();                                                  //set to IDLE
-    spi_write_strobe(SFRX);delayMicroseconds(100);            //flush RX Buffer
-    receive();                                                //set to receive mode
 
     return res;
 }
@@ -368,63 +428,58 @@ uint8_t CC1101_Oregon::rx_payload_burst(uint8_t rxbuffer[], uint8_t &pktlen)
 //----------------------[check if Packet is received]---------------------------
 uint8_t CC1101_Oregon::packet_available()
 {
-    if (digitalRead(GDO2) == TRUE)                           //if RF package received
+    if (transport->pin_read(GDO2) == TRUE)                           //if RF package received
     {
-       while (digitalRead(GDO2) == TRUE) ;               //wait till sync word is fully received
+       while (transport->pin_read(GDO2) == TRUE) ;               //wait till sync word is fully received
        return TRUE;
     }
     return FALSE;
 }
 //-------------------------------[end]------------------------------------------
 
+//-------------------[GDO2 edge events instead of polling]----------------------
+uint8_t CC1101_Oregon::packet_events_begin(void)
+{
+    return transport->gdo2_events_begin(GDO2_GPIOCHIP, GDO2_LINE) == 0;
+}
+
+uint8_t CC1101_Oregon::wait_packet(int timeout_ms)
+{
+    return transport->wait_gdo2(timeout_ms, &last_event_ns) > 0;   //end of packet (GDO2 falling edge)
+}
+//-------------------------------[end]------------------------------------------
+
 
 uint8_t CC1101_Oregon::oregon_decode(uint8_t rxbuffer[], uint8_t pos, uint8_t &pktlen, uint8_t offset_bits)
 {
-	uint16_t curr_window;
-	uint32_t curr_window32;
-	uint8_t i,j;
-	uint8_t *rxbuffer_loc = rxbuffer+pos;
-	// shift buffer with offset_bits
-    for(i = 0 ; i < pktlen-1; i++)
-    {
-    	curr_window = (rxbuffer_loc[i] << 8) + rxbuffer_loc[i+1];
-    	rxbuffer_loc[i] = ((curr_window >> (8-offset_bits)) & 0xFF);
- 	    if (rxbuffer_loc[i] != 0x99 && rxbuffer_loc[i] != 0x96 && rxbuffer_loc[i] != 0x69 && rxbuffer_loc[i] != 0x66) {
- 	    	if (debug_level > 0)
- 			   printf("Oregon packet bit error!\n");
- 	    	return FALSE;
- 	    }
-    }
-    if (rxbuffer_loc[0] != 0x96 || rxbuffer_loc[1] != 0x96) {
-    	if (debug_level > 0)
-		   printf("Oregon sync nibble (0xA) not found!\n");
+	oregon_err_t err;
+	uint8_t len;
+
+	// decoded bytes go to the start of the same buffer, pktlen updated accordingly
+	if ((err = oregon_decode_symbols(rxbuffer, pos + pktlen, pos, offset_bits, rxbuffer, len)) != OREGON_OK) {
+		if (debug_level > 0)
+			printf("%s\n", oregon_strerror(err));
 		return FALSE;
-    }
-	rxbuffer_loc += 2;
-	pktlen -= 3;
-    // do manchester and double-bit decode simultaneously,
-    // result goes in the same buffer, pktlen updated accordingly
-	pktlen /= 4;
-    for(i = 0 ; i < pktlen; i++)
-    {
-    	curr_window32 = (rxbuffer_loc[i*4] << 8) + rxbuffer_loc[i*4+1] + (rxbuffer_loc[i*4+2] << 24) + (rxbuffer_loc[i*4+3] << 16);
-    	rxbuffer[i] = 0;
-    	for (j=0; j < 8; j++) {
-    		rxbuffer[i] = (rxbuffer[i] << 1) + (((curr_window32 & 0xf)==0x6)?1:0);
-    		curr_window32 >>=  4;
-    	}
-    }
+	}
+	pktlen = len;
 	return TRUE;
 }
 
 
 
 //------------------[check Payload for ACK or Data]-----------------------------
-uint8_t CC1101_Oregon::get_oregon_raw(uint8_t rxbuffer[], uint8_t &pktlen, int8_t &rssi_dbm, uint8_t &lqi)
+uint8_t CC1101_Oregon::get_oregon_raw(uint8_t rxbuffer[], uint8_t &pktlen, int8_t &rssi_dbm, uint8_t &lqi, oregon_raw_t *raw)
 {
-    uint8_t i, res;
-    int8_t offset_bits;
+    oregon_frame_t frame;
+    oregon_err_t err;
+    uint8_t i;
 
+    sync_offset = OREGON_SYNC_NO_SEARCH;
+    sync_score = 0;
+    if (raw) {
+    	raw->len = 0;
+    	raw->sync_offset = OREGON_SYNC_NO_SEARCH;
+    }
     rx_fifo_erase(rxbuffer);                               //delete rx_fifo bufffer
 
     if(rx_payload_burst(rxbuffer, pktlen) == FALSE)        //read package in buffer
@@ -434,14 +489,15 @@ uint8_t CC1101_Oregon::get_oregon_raw(uint8_t rxbuffer[], uint8_t &pktlen, int8_
     }
     else
     {
-    	if (pktlen<32) {
+    	if (pktlen < OREGON_MIN_RAW_LEN + 2) {
         	if (debug_level > 0)
-        		printf("Packet number less than 32!\n");
+        		printf("Packet length %d less than %d!\n", pktlen, OREGON_MIN_RAW_LEN + 2);
     		return FALSE;
     	}
-            rssi_dbm = rssi_convert(rxbuffer[pktlen-2]); //converts receiver strength to dBm
-            lqi = lqi_convert(rxbuffer[pktlen-1]);       //get rf quality indicator
             pktlen -= 2; //compensate for rssi and lqi
+            err = oregon_decode_frame(rxbuffer, pktlen, rxbuffer[pktlen], rxbuffer[pktlen+1], &frame);
+            rssi_dbm = frame.reading.rssi_dbm;
+            lqi = frame.reading.lqi;
 
             if(debug_level > 1) {                           //debug output messages
                 printf("RX_FIFO: ");
@@ -455,88 +511,86 @@ uint8_t CC1101_Oregon::get_oregon_raw(uint8_t rxbuffer[], uint8_t &pktlen, int8_
                 printf("LQI: %d ", lqi);
                 printf("\r\n");
             }
-#if THN122N_CHECK_CC_IN_BUF
-			// check if first 2 bytes are CC
-			if (rxbuffer[0] != 0xCC || rxbuffer[1] != 0xCC )
-			{
-				if (debug_level > 0)
-					printf("First 2 bytes are not 0xCC!\n");
-				return FALSE;
-			}
-#endif
-			// determine sync nibble start offset
-            for(i = THN122N_START_SEARCH_AT ; i < 5; i++)
-            {
-            		if (rxbuffer[i] == 0xD2 || rxbuffer[i] == 0xCD) {
-            			if (rxbuffer[i] == 0xD2)
-            				offset_bits = 3;
-            			else
-            				offset_bits = 7;
-            			pktlen -= i; // compensate for sync start
-            			break;
-            		}
+            sync_pos = frame.sync_pos;
+            sync_offset = frame.sync_offset;
+            sync_score = frame.sync_score;
+            if (raw) {
+            	// keep the symbols for combining with the other burst
+            	memcpy(raw->data, rxbuffer, pktlen);
+            	raw->len = pktlen;
+            	raw->rssi_raw = rxbuffer[pktlen];
+            	raw->lqi_raw = rxbuffer[pktlen+1];
+            	raw->sync_pos = sync_pos;
+            	raw->sync_offset = sync_offset;
             }
-            if (i==5)
-			{
+            // up to the symbol decode it is a burst error, the rest is judged by the caller
+            if (!OREGON_BURST_OK(err)) {
             	if (debug_level > 0)
-            		printf("Start of Oregon sync nibble not found!\n");
+            		printf("%s\n", oregon_strerror(err));
             	return FALSE;
-			}
+            }
             if(debug_level > 1) {                           //debug output messages
-            	printf("sync @ pos %d, offset %d\n", i, offset_bits);
+            	printf("sync @ pos %d, offset %d, score %d/%d\n", sync_pos, sync_offset, sync_score, OREGON_SYNC_MAX_SCORE);
             }
-            // oregon decode with an offset
-            res = oregon_decode(rxbuffer, i, pktlen, offset_bits);
-
-            return res;
+            memcpy(rxbuffer, frame.data, frame.len);
+            pktlen = frame.len;
+            return TRUE;
     }
 }
 
 //-------------------------------[end]------------------------------------------
 
-uint8_t CC1101_Oregon::get_oregon_data(uint8_t rxbuffer[], uint8_t pktlen, oregon_data_t *oregon_data)
+//------------------[FIFO bytes, decoded by the caller]-------------------------
+uint8_t CC1101_Oregon::get_oregon_fifo(oregon_raw_t *raw)
 {
-    uint8_t chn;
-    uint16_t checksum;
-	double temperature;
-	uint8_t i,j;
+    uint8_t pktlen;
 
-	// for the moment decoding only THN122N/THN132N sensors!
-    if (rxbuffer[0] != 0xEC || rxbuffer[1] != 0x40) {
-		printf("Oregon ID 0xEC40 not found!\n");
-		return FALSE;
-    }
-    oregon_data->sensor_id = (rxbuffer[0] << 8) + rxbuffer[1];
-    // calculate checksum
-    checksum = 0;
-    for(i = 0 ; i < 6; i++)
-		for (j=0; j < 2; j++) {
-			checksum += (rxbuffer[i] >> (j*4)) & 0xf;
-		}
-    // if checksum larger than 0xff, add upper byte bits to lower byte
-    checksum = ((checksum & 0xff) + (checksum >> 8)) & 0xff;
-    // invert checksum nibbles
-    checksum = (checksum >> 4) + ((checksum << 4) & 0xf0);
-    oregon_data->cksum_ok = (checksum == rxbuffer[6]);
-    oregon_data->batt_low = (rxbuffer[3] & 0x4) >> 2;
-    temperature = 0;
-    temperature = ((rxbuffer[5] & 0xf0) >> 4) * 10 + (rxbuffer[4] & 0xf) + ((rxbuffer[4] & 0xf0) >> 4) * 0.1;
-    if (rxbuffer[5] & 0xf)
-    	temperature = -temperature;
-    oregon_data->temperature = temperature;
-    chn = (rxbuffer[2] & 0xf0) >> 4;
-    for(i = 1 ; i < 5; i++) {
-    	chn >>= 1;
-    	if (!chn)
-    		break;
-    }
-    oregon_data->channel = i;
-    oregon_data->roll_code = ((rxbuffer[2] & 0xf) << 4) + ((rxbuffer[3] & 0xf0) >> 4);
+    raw->len = 0;
+    raw->rssi_raw = raw->lqi_raw = 0;
+    raw->sync_pos = 0;
+    raw->sync_offset = OREGON_SYNC_NO_SEARCH;
+    // data has room for RSSI and LQI as well (OREGON_RAW_MAX == FIFOBUFFER)
+    if (rx_payload_burst(raw->data, pktlen) == FALSE || pktlen < OREGON_MIN_RAW_LEN + 2)
+        return FALSE;
+    pktlen -= 2;
+    raw->len = pktlen;
+    raw->rssi_raw = raw->data[pktlen];
+    raw->lqi_raw = raw->data[pktlen+1];
     return TRUE;
 }
+//-------------------------------[end]------------------------------------------
 
+uint8_t CC1101_Oregon::oregon_combine(const oregon_raw_t *raw1, const oregon_raw_t *raw2, uint8_t rxbuffer[], uint8_t &pktlen)
+{
+	oregon_frame_t frame;
+	oregon_err_t err;
 
+	err = oregon_combine_raw(raw1, raw2, &frame);
+	if (err != OREGON_OK) {
+		if (debug_level > 0 && err == OREGON_ERR_CHECKSUM)
+			printf("Oregon bursts combined, checksum still wrong!\n");
+		return FALSE;
+	}
+	if (debug_level > 0)
+		printf("Oregon frame rebuilt from both bursts (%d conflicts)\n", frame.conflicts);
+	memcpy(rxbuffer, frame.data, frame.len);
+	pktlen = frame.len;
+	return TRUE;
+}
+
+uint8_t CC1101_Oregon::get_oregon_data(uint8_t rxbuffer[], uint8_t pktlen, oregon_data_t *oregon_data)
+{
+	oregon_err_t err;
 
+	// a checksum error still gives the fields, with cksum_ok cleared
+	err = oregon_parse_thn122n(rxbuffer, pktlen, oregon_data);
+	if (err == OREGON_ERR_ID || err == OREGON_ERR_PKTLEN) {
+		if (debug_level > 0)
+			printf("%s\n", oregon_strerror(err));
+		return FALSE;
+	}
+	return TRUE;
+}
 //--------------------------[tx_fifo_erase]-------------------------------------
 void CC1101_Oregon::tx_fifo_erase(uint8_t *txbuffer)
 {
@@ -564,27 +618,14 @@ void CC1101_Oregon::set_patable(uint8_t *patable_arr)
 //--------------------------[rssi_convert]--------------------------------------
 int8_t CC1101_Oregon::rssi_convert(uint8_t Rssi_hex)
 {
-    int8_t rssi_dbm;
-    int16_t Rssi_dec;
-
-    Rssi_dec = Rssi_hex;        //convert unsigned to signed
-
-    if(Rssi_dec >= 128){
-        rssi_dbm=((Rssi_dec-256)/2)-RSSI_OFFSET_868MHZ;
-    }
-    else{
-        if(Rssi_dec<128){
-            rssi_dbm=((Rssi_dec)/2)-RSSI_OFFSET_868MHZ;
-        }
-    }
-    return rssi_dbm;
+    return oregon_rssi_dbm(Rssi_hex);
 }
 //-------------------------------[end]------------------------------------------
 
 //----------------------------[lqi convert]-------------------------------------
 uint8_t CC1101_Oregon::lqi_convert(uint8_t lqi)
 {
-    return (lqi & 0x7F);
+    return oregon_lqi(lqi);
 }
 //-------------------------------[end]------------------------------------------
 
@@ -600,10 +641,10 @@ void CC1101_Oregon::spi_begin(void)
 {
      int x = 0;
      //printf ("init SPI bus... ");
-     if ((x = wiringPiSPISetup (0, 8000000)) < 0)  //4MHz SPI speed
+     if ((x = transport->spi_begin(CC1101_SPI_SPEED)) < 0)  //8MHz SPI speed
      {
           if(debug_level > 0){
-          printf ("ERROR: wiringPiSPISetup failed!\r\n");
+          printf ("ERROR: SPI setup failed!\r\n");
           }
      }
 }
@@ -614,7 +655,7 @@ void CC1101_Oregon::spi_write_register(uint8_t spi_instr, uint8_t value)
      tbuf[0] = spi_instr | WRITE_SINGLE_BYTE;
      tbuf[1] = value;
      uint8_t len = 2;
-     wiringPiSPIDataRW (0, tbuf, len) ;
+     transport->spi_data_rw(tbuf, len) ;
 
      return;
 }
@@ -625,7 +666,7 @@ uint8_t CC1101_Oregon::spi_read_register(uint8_t spi_instr)
      uint8_t rbuf[2] = {0};
      rbuf[0] = spi_instr | READ_SINGLE_BYTE;
      uint8_t len = 2;
-     wiringPiSPIDataRW (0, rbuf, len) ;
+     transport->spi_data_rw(rbuf, len) ;
      value = rbuf[1];
      return value;
 }
@@ -634,14 +675,14 @@ void CC1101_Oregon::spi_write_strobe(uint8_t spi_instr)
 {
      uint8_t tbuf[1] = {0};
      tbuf[0] = spi_instr;
-     wiringPiSPIDataRW (0, tbuf, 1) ;
+     transport->spi_data_rw(tbuf, 1) ;
  }
 //|======= read multiple registers =======|
 void CC1101_Oregon::spi_read_burst(uint8_t spi_instr, uint8_t *pArr, uint8_t len)
 {
      uint8_t rbuf[len + 1];
      rbuf[0] = spi_instr | READ_BURST;
-     wiringPiSPIDataRW (0, rbuf, len + 1) ;
+     transport->spi_data_rw(rbuf, len + 1) ;
      for (uint8_t i=0; i<len ;i++ )
      {
           pArr[i] = rbuf[i+1];
@@ -656,7 +697,7 @@ void CC1101_Oregon::spi_write_burst(uint8_t spi_instr, uint8_t *pArr, uint8_t le
      {
           tbuf[i+1] = pArr[i];
      }
-     wiringPiSPIDataRW (0, tbuf, len + 1) ;
+     transport->spi_data_rw(tbuf, len + 1) ;
 }
 //|================================= END =======================================|
 
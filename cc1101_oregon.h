@@ -9,6 +9,8 @@
 #define CC1101_OREGON_H_
 
 #include <stdint.h>
+#include "cc1101_transport.h"
+#include "oregon_decoder.h"
 
 
 /*----------------------------------[standard]--------------------------------*/
@@ -19,6 +21,9 @@
 //**************************** pins ******************************************//
 #define SS_PIN   10
 #define GDO2      6
+// GDO2 as seen by the GPIO character device (Broadcom numbering) - event mode
+#define GDO2_GPIOCHIP  "/dev/gpiochip0"
+#define GDO2_LINE      25
 //#define GDO0     99
 
 /*----------------------[CC1101 - misc]---------------------------------------*/
@@ -118,6 +123,14 @@
 #define SNOP     0x3D         // No operation.
 /*-------------------------[END command strobes]------------------------------*/
 
+/*----------------------[Wake-on-Radio - Oregon v2.1]--------------------------*/
+#define OREGON_PREAMBLE_RAW_BITS  64    //16 '1' data bits of 4 raw bits each, before the sync nibble
+#define OREGON_SYNC_RAW_BITS      16    //of them the chip needs to match SYNC1/SYNC0
+#define WOR_CS_SYMBOLS            8     //RX_TIME_RSSI: RX ends without a carrier within these
+#define WOR_EVENT1_PERIODS        48    //WORCTRL.EVENT1 = 7: crystal start-up before RX
+#define WOR_MARGIN_PCT            12    //of the EVENT0 limit, for repeat jitter and RC oscillator error
+#define WOR_MCSM2                 0x17  //RX_TIME_RSSI = 1, RX_TIME = 7: until end of packet
+
 /*----------------------[CC1101 - status register]----------------------------*/
 #define PARTNUM        0xF0   // Part number
 #define HW_VERSION     0xF1   // Current version number
@@ -135,56 +148,23 @@
 #define RCCTRL0_STATUS 0xFD   //Last RC Oscillator Calibration Result
 //--------------------------[END status register]-------------------------------
 
-// ------- definition of starting nibbles in THN122N/THN132N sensors -----------
-
-#define THN122N_ID_SNIBBLE 0
-#define THN122N_CHANNEL_NIBBLE 4
-#define THN122N_RCODE_SNIBBLE 5
-#define THN122N_FLAGS_NIBBLE 7
-#define THN122N_TEMPC_SNIBBLE 8
-#define THN122N_CKSUM_SNIBBLE 12
-#define THN122N_POSTAMBLE_SNIBBLE 14
-
-// ------- end definition of starting nibbles in THN122N/THN132N sensors -------
-
-// ------- fine tuning of probe packets sync and decoding -------
-
-#define THN122N_MIN_PKTLEN_FOR_DECODE 8
-// what is used currently as data after decoding
-#define THN122N_PKTLEN_USED_DECODE (THN122N_MIN_PKTLEN_FOR_DECODE-1)
-
-#define THN122N_CHECK_CC_IN_BUF	0
-
-// ------- end fine tuning of probe packets sync and decoding -------
-
-#if THN122N_CHECK_CC_IN_BUF
-#define THN122N_START_SEARCH_AT	2
-#else
-#define THN122N_START_SEARCH_AT	0
-#endif
-
-typedef struct {
-	uint16_t sensor_id;
-	uint8_t  channel;
-	uint8_t  roll_code;
-	uint8_t  batt_low;
-	double  temperature;
-	uint8_t  cksum_ok;
-	int8_t  rssi_dbm; // the higher the better
-	uint8_t  lqi;     // the lower the better
-} oregon_data_t;
-
 class CC1101_Oregon
 {
     private:
+        CC1101_Transport *transport;
 
         void spi_begin(void);
         void spi_end(void);
         uint8_t spi_putc(uint8_t data);
 
+
     public:
         uint8_t debug_level;
 
+        CC1101_Oregon(CC1101_Transport *transport = 0) : transport(transport), debug_level(0),
+            wor_event0_us(0), wor_listen_us(0), sync_pos(0), sync_offset(OREGON_SYNC_NO_SEARCH), sync_score(0) {}
+        void set_transport(CC1101_Transport *set_transport) { transport = set_transport; }
+
         uint8_t set_debug_level(uint8_t set_debug_level = 1);
         uint8_t get_debug_level(void);
 
@@ -202,9 +182,12 @@ class CC1101_Oregon
         void wakeup(void);
         void powerdown(void);
 
-        void wor_enable(void);
+        // WOR as programmed by the last wor_enable - wake-up period, and listening per wake-up without a carrier
+        uint32_t wor_event0_us, wor_listen_us;
+        uint32_t wor_enable(unsigned int repeat_ms);
         void wor_disable(void);
         void wor_reset(void);
+        uint32_t data_rate(void);
 
         uint8_t sidle(void);
         uint8_t receive(void);
@@ -213,9 +196,19 @@ class CC1101_Oregon
         void show_main_settings(void);
 
         uint8_t packet_available();
-
-        uint8_t get_oregon_raw(uint8_t rxbuffer[], uint8_t &pktlen_rx, int8_t &rssi_dbm, uint8_t &lqi);
+        // event-driven alternative to packet_available (GDO2 edges, no busy wait)
+        uint64_t last_event_ns;
+        uint8_t packet_events_begin(void);
+        uint8_t wait_packet(int timeout_ms);
+
+        // result of the sync search of the last get_oregon_raw
+        uint8_t sync_pos, sync_offset, sync_score;
+        uint8_t get_oregon_raw(uint8_t rxbuffer[], uint8_t &pktlen_rx, int8_t &rssi_dbm, uint8_t &lqi, oregon_raw_t *raw = 0);
+        // FIFO bytes only, no decoding (raw->len 0 - nothing read) - for a separate decode thread
+        uint8_t get_oregon_fifo(oregon_raw_t *raw);
         uint8_t oregon_decode(uint8_t rxbuffer[], uint8_t pos, uint8_t &pktlen, uint8_t offset_bits);
+        // rebuild a frame from two bursts that failed decoding, nibble by nibble
+        uint8_t oregon_combine(const oregon_raw_t *raw1, const oregon_raw_t *raw2, uint8_t rxbuffer[], uint8_t &pktlen);
 
         uint8_t get_oregon_data(uint8_t rxbuffer[], uint8_t pktlen, oregon_data_t *oregon_data);
 
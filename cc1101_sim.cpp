@@ -0,0 +1,614 @@
+/*
+ * cc1101_sim.cpp
+ *
+ *  Created on: 17Oct.,2026
+ */
+
+#include "cc1101_sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_NEVER	(~(uint64_t)0)
+
+//----------------------[THN122N payload generator]-----------------------------
+void oregon_sim_thn122n_payload(uint16_t sensor_id, uint8_t channel, uint8_t roll_code,
+                                uint8_t batt_low, int16_t temp_deci, uint8_t payload[8])
+{
+    uint16_t checksum, t;
+    uint8_t i, j;
+
+    t = (temp_deci < 0) ? -temp_deci : temp_deci;
+    payload[0] = sensor_id >> 8;
+    payload[1] = sensor_id & 0xff;
+    payload[2] = ((1 << (channel - 1)) << 4) + (roll_code >> 4);
+    payload[3] = ((roll_code & 0xf) << 4) + (batt_low ? 0x4 : 0);
+    payload[4] = ((t % 10) << 4) + ((t / 10) % 10);         // tenths | units
+    payload[5] = (((t / 100) % 10) << 4) + ((temp_deci < 0) ? 0x8 : 0);
+    // same checksum as oregon_thn122n_checksum_ok
+    checksum = 0;
+    for(i = 0 ; i < 6; i++)
+        for (j=0; j < 2; j++)
+            checksum += (payload[i] >> (j*4)) & 0xf;
+    checksum = ((checksum & 0xff) + (checksum >> 8)) & 0xff;
+    payload[6] = (checksum >> 4) + ((checksum << 4) & 0xf0);
+    payload[7] = 0;                                         // postamble
+}
+//-------------------------------[end]------------------------------------------
+
+//------------------------[Oregon v2.1 encoder]---------------------------------
+// Every data bit is a 4-bit symbol (0 -> 1001, 1 -> 0110), nibbles go LSB first,
+// the high nibble of a payload byte first. Bits before sync_bit are preamble
+// ('1' symbols), bits after the payload are '0' symbols up to the end of the FIFO.
+void oregon_sim_encode(const uint8_t *payload, uint8_t plen, int sync_bit, uint8_t *fifo, uint8_t fifolen)
+{
+    int p, rel, dbit, nbits;
+    uint8_t sym, bit, data;
+
+    memset(fifo, 0, fifolen);
+    nbits = 4 + plen * 8;                                   // sync nibble + payload
+    for(p = 0; p < fifolen * 8; p++)
+    {
+        rel = p - sync_bit;
+        if (rel < 0) {
+            sym = 0x6;
+            rel = ((rel % 4) + 4) % 4;
+        } else {
+            dbit = rel / 4;
+            if (dbit < 4)
+                data = dbit & 1;                            // sync nibble 0xA, LSB first
+            else if (dbit < nbits) {
+                dbit -= 4;
+                data = payload[dbit / 8];
+                data = (dbit & 0x4) ? data : (data >> 4);   // high nibble first
+                data = (data >> (dbit & 0x3)) & 1;          // LSB first
+            } else
+                data = 0;
+            sym = data ? 0x6 : 0x9;
+            rel %= 4;
+        }
+        bit = (sym >> (3 - rel)) & 1;
+        fifo[p / 8] |= bit << (7 - (p % 8));
+    }
+}
+//-------------------------------[end]------------------------------------------
+
+CC1101_Sim::CC1101_Sim()
+{
+    now_us = 0;
+    duration_us = (uint64_t)SIM_DURATION_S * 1000000;
+    rnd = 0x2545F491;
+    memset(regs, 0, sizeof(regs));
+    memset(patable, 0, sizeof(patable));
+    marcstate = SIM_MARC_IDLE;
+    gdo2 = 0;
+    fifo_len = fifo_rd = 0;
+    num_sensors = 0;
+    bit_error_ppm = 0;
+    num_frames = 0;
+    active_valid = 0;
+    wor_on = 0;
+    wor_event_us = wor_next_us = 0;
+    frames_sent = frames_received = frames_missed = frames_collided = frames_dropped = 0;
+    readings_checked = readings_twice = readings_wrong = 0;
+    rx_us = idle_us = sleep_us = 0;
+}
+
+uint32_t CC1101_Sim::random(void)
+{
+    // xorshift32 - deterministic, no shared state
+    rnd ^= rnd << 13;
+    rnd ^= rnd >> 17;
+    rnd ^= rnd << 5;
+    return rnd;
+}
+
+//--------------------------[traffic generator]---------------------------------
+int CC1101_Sim::add_sensor(uint16_t sensor_id, uint8_t channel, uint8_t roll_code, int16_t temp_deci,
+                           unsigned int period_ms, unsigned int phase_ms, int8_t rssi_dbm)
+{
+    sim_sensor_t *s;
+
+    if (num_sensors >= SIM_MAX_SENSORS || channel < 1 || channel > 3)
+        return FALSE;
+    s = &sensors[num_sensors++];
+    s->sensor_id = sensor_id;
+    s->channel = channel;
+    s->roll_code = roll_code;
+    s->batt_low = 0;
+    s->temp_deci = temp_deci;
+    s->rssi_dbm = rssi_dbm;
+    s->period_ms = period_ms;
+    s->next_tx_us = now_us + (uint64_t)phase_ms * 1000;
+    memset(s->sent, 0, sizeof(s->sent));
+    s->sent_no = s->published_no = 0;
+    return TRUE;
+}
+
+void CC1101_Sim::add_thn122n_sensors(int num)
+{
+    int i;
+    uint8_t channel;
+
+    for(i = 0; i < num; i++)
+    {
+        // THN122N transmit period depends on the channel: 39/41/43 s
+        channel = i % 3 + 1;
+        add_sensor(0xEC40, channel, (0x87 + i * 37) & 0xff, 183 + i,
+                   37000 + channel * 2000, random() % 40000, -60 - (i % 30));
+    }
+}
+
+void CC1101_Sim::schedule_traffic(void)
+{
+    int i;
+    sim_sensor_t *s;
+
+    for(i = 0; i < num_sensors; i++)
+    {
+        s = &sensors[i];
+        while (s->next_tx_us <= now_us + (uint64_t)SIM_LOOKAHEAD_MS * 1000) {
+            queue_message(s, s->next_tx_us);
+            // small clock jitter of the sensor
+            s->next_tx_us += (uint64_t)s->period_ms * 1000 + (random() % 2000) - 1000;
+        }
+    }
+}
+
+// sync nibble somewhere in the first 5 FIFO bytes, alignment as seen from real sensors;
+// a few frames lock late or a bit or two off that grid (bit sync still settling)
+int CC1101_Sim::random_sync_bit(void)
+{
+    int bit = 3 + 4 * (random() % 9);
+
+    if (random() % 100 < SIM_SYNC_SLIP_PCT)
+        bit += 4 * (random() % 4) + (int)(random() % 5) - 2;
+    return bit;
+}
+
+void CC1101_Sim::queue_message(sim_sensor_t *s, uint64_t at_us)
+{
+    uint8_t payload[8];
+    sim_frame_t f;
+    int burst;
+
+    s->temp_deci += (int)(random() % 3) - 1;
+    if (++s->sent_no == 0)     // 0 - none
+        s->sent_no = 1;
+    __atomic_store_n(&s->sent[s->sent_no % SIM_SENT_LEN], ((uint64_t)(uint32_t)(at_us / 1000) << 32) |
+                     ((uint64_t)(uint16_t)s->temp_deci << 16) | s->sent_no, __ATOMIC_RELEASE);
+    oregon_sim_thn122n_payload(s->sensor_id, s->channel, s->roll_code, s->batt_low, s->temp_deci, payload);
+    // Oregon v2.1 sends every message twice
+    for(burst = 0; burst < 2; burst++)
+    {
+        memset(&f, 0, sizeof(f));
+        f.sync_us = at_us + (uint64_t)burst * SIM_BURST_SPACING_MS * 1000;
+        oregon_sim_encode(payload, sizeof(payload), random_sync_bit(), f.data, SIM_FIFO_SIZE - 2);
+        if (bit_error_ppm)
+            corrupt_frame(&f, 0, 0);
+        f.rssi_raw = ((s->rssi_dbm + RSSI_OFFSET_868MHZ) * 2 + (int)(random() % 5) - 2) & 0xff;
+        f.lqi_raw = 0x80 | (random() % 40 + 10);
+        queue_frame(&f);
+    }
+}
+
+void CC1101_Sim::queue_frame(sim_frame_t *f)
+{
+    int i;
+
+    if (num_frames >= SIM_MAX_FRAMES) {
+        frames_dropped++;
+        return;
+    }
+    // sorted descending by sync time - the next frame on air is the last one
+    for(i = num_frames; i > 0 && frames[i-1].sync_us < f->sync_us; i--)
+        ;
+    memmove(&frames[i+1], &frames[i], (num_frames - i) * sizeof(sim_frame_t));
+    frames[i] = *f;
+    num_frames++;
+    frames_sent++;
+}
+
+// bits == 0: random bit errors over the whole frame with bit_error_ppm probability
+void CC1101_Sim::corrupt_frame(sim_frame_t *f, int from_bit, int bits)
+{
+    int p, nbits = (SIM_FIFO_SIZE - 2) * 8;
+
+    if (from_bit < 0 || from_bit >= nbits)
+        return;
+    if (bits == 0) {
+        for(p = from_bit; p < nbits; p++)
+            if (random() % 1000000 < bit_error_ppm)
+                f->data[p / 8] ^= 0x80 >> (p % 8);
+    } else {
+        while (bits--) {
+            p = from_bit + random() % (nbits - from_bit);
+            f->data[p / 8] ^= 0x80 >> (p % 8);
+        }
+    }
+    f->corrupt = 1;
+}
+//-------------------------------[end]------------------------------------------
+
+//----------------------------[event processing]--------------------------------
+void CC1101_Sim::complete_frame(void)
+{
+    uint8_t len = regs[PKTLEN];
+
+    if (len > SIM_FIFO_SIZE - 2)
+        len = SIM_FIFO_SIZE - 2;
+    if (fifo_len - fifo_rd + len + 2 > SIM_FIFO_SIZE) {
+        marcstate = SIM_MARC_RXFIFO_OVERFLOW;
+    } else {
+        if (fifo_rd) {
+            memmove(fifo, fifo + fifo_rd, fifo_len - fifo_rd);
+            fifo_len -= fifo_rd;
+            fifo_rd = 0;
+        }
+        memcpy(fifo + fifo_len, active.data, len);
+        fifo_len += len;
+        fifo[fifo_len++] = active.rssi_raw;                 // PKTCTRL1.APPEND_STATUS
+        fifo[fifo_len++] = active.lqi_raw;
+        // MCSM1.RXOFF_MODE - stay in RX or go to IDLE
+        marcstate = (((regs[MCSM1] >> 2) & 0x3) == 0x3) ? SIM_MARC_RX : SIM_MARC_IDLE;
+    }
+    frames_received++;
+    active_valid = 0;
+    gdo2 = 0;
+}
+
+void CC1101_Sim::run_events(void)
+{
+    uint64_t next_sync;
+    sim_frame_t *f;
+
+    schedule_traffic();
+    for(;;)
+    {
+        next_sync = num_frames ? frames[num_frames-1].sync_us : SIM_NEVER;
+        if (active_valid && active.end_us <= now_us && active.end_us <= next_sync) {
+            complete_frame();
+            continue;
+        }
+        if (next_sync > now_us)
+            break;
+        // asleep on WOR: an EVENT0 may still come while enough of the preamble is left
+        if (wor_on && marcstate == SIM_MARC_SLEEP &&
+                now_us < next_sync + bits_us(OREGON_PREAMBLE_RAW_BITS - 2 * OREGON_SYNC_RAW_BITS))
+            break;
+        f = &frames[--num_frames];
+        if (active_valid) {
+            // overlapping transmission - the frame being received gets garbled from here on
+            frames_collided++;
+            corrupt_frame(&active, (int)((f->sync_us - active.sync_us) * SIM_BITRATE / 1000000), 16);
+        } else if (marcstate == SIM_MARC_RX) {
+            active = *f;
+            active.end_us = f->sync_us + (uint64_t)regs[PKTLEN] * 8 * 1000000 / SIM_BITRATE;
+            active_valid = 1;
+            gdo2 = 1;                                       // IOCFG2 = 0x06, asserted on sync word
+        } else
+            frames_missed++;
+    }
+}
+
+void CC1101_Sim::account(uint64_t us)
+{
+    if (marcstate == SIM_MARC_SLEEP)
+        sleep_us += us;
+    else if (marcstate == SIM_MARC_IDLE)
+        idle_us += us;
+    else
+        rx_us += us;
+    now_us += us;
+}
+
+void CC1101_Sim::advance(uint64_t us)
+{
+    uint64_t until = now_us + us;
+
+    while (wor_on && wor_next_us <= until) {
+        account((wor_next_us > now_us) ? wor_next_us - now_us : 0);
+        run_events();
+        if (wor_on)
+            wor_wakeup();
+    }
+    account(until - now_us);
+    run_events();
+}
+//-------------------------------[end]------------------------------------------
+
+//----------------------------[Wake-on-Radio]-----------------------------------
+uint64_t CC1101_Sim::wor_event0_us(void)
+{
+    return ((uint64_t)regs[WOREVT1] << 8 | regs[WOREVT0]) * 750000 / (CRYSTAL_FREQUENCY / 1000)
+            << (5 * (regs[WORCTRL] & 0x3));
+}
+
+// EVENT0 reached (asleep) or the listening after it is over (in RX). EVENT1 - the crystal
+// start-up - counts as RX. A burst is caught if the radio gets to RX no later than its sync
+// word in a continuous RX would start, plus the rest of the preamble.
+void CC1101_Sim::wor_wakeup(void)
+{
+    static const uint8_t event1_periods[8] = { 4, 6, 8, 12, 16, 24, 32, 48 };
+    uint64_t rx_at, listen_us, on_air, latest, sync_at;
+    uint8_t rx_time = regs[MCSM2] & 0x7;
+    sim_frame_t *f;
+
+    if (marcstate != SIM_MARC_SLEEP) {
+        marcstate = SIM_MARC_SLEEP;                         // RX timeout - back to sleep
+        wor_next_us = wor_event_us + wor_event0_us();
+        return;
+    }
+    wor_event_us = now_us;
+    marcstate = SIM_MARC_RX;
+    rx_at = now_us + (uint64_t)event1_periods[(regs[WORCTRL] >> 4) & 0x7] * 750000 / (CRYSTAL_FREQUENCY / 1000);
+    // RX_TIME 7 - no timeout; RX_TIMEOUT of WOR_RES = 0 otherwise
+    listen_us = (rx_time == 7) ? SIM_NEVER : (wor_event0_us() / 8 >> rx_time);
+    f = num_frames ? &frames[num_frames-1] : NULL;
+    if (f) {
+        on_air = f->sync_us - bits_us(OREGON_SYNC_RAW_BITS);
+        if ((regs[MCSM2] & 0x10) && (on_air >= rx_at + bits_us(WOR_CS_SYMBOLS) ||
+                rx_at >= f->sync_us + bits_us(regs[PKTLEN] * 8)))
+            f = NULL;                                       // RX_TIME_RSSI - no carrier
+        else if (listen_us != SIM_NEVER && on_air >= rx_at + listen_us)
+            f = NULL;
+    }
+    if (f) {
+        latest = f->sync_us + bits_us(OREGON_PREAMBLE_RAW_BITS - 2 * OREGON_SYNC_RAW_BITS);
+        sync_at = rx_at + bits_us(OREGON_SYNC_RAW_BITS);
+        if (sync_at < f->sync_us)
+            sync_at = f->sync_us;
+        if (rx_at <= latest && (listen_us == SIM_NEVER || sync_at <= rx_at + listen_us)) {
+            f->sync_us = sync_at;
+            wor_on = 0;                                     // caught - RX to the end of packet, then RXOFF_MODE
+            return;
+        }
+        num_frames--;                                       // too late in the burst for its sync word
+        frames_missed++;
+    } else if (regs[MCSM2] & 0x10)
+        listen_us = bits_us(WOR_CS_SYMBOLS);
+    if (listen_us == SIM_NEVER) {
+        wor_on = 0;                                         // RX until a packet comes
+        return;
+    }
+    wor_next_us = rx_at + listen_us;
+}
+//-------------------------------[end]------------------------------------------
+
+//------------------------------[chip model]------------------------------------
+uint8_t CC1101_Sim::status_byte(void)
+{
+    uint8_t state, avail;
+
+    switch (marcstate) {
+        case SIM_MARC_RX:               state = 1; break;
+        case SIM_MARC_RXFIFO_OVERFLOW:  state = 6; break;
+        default:                        state = 0; break;
+    }
+    avail = fifo_len - fifo_rd;
+    return (state << 4) | ((avail > 15) ? 15 : avail);
+}
+
+uint8_t CC1101_Sim::read_status_reg(uint8_t addr)
+{
+    switch (addr | 0xC0) {
+        case PARTNUM:       return 0x00;
+        case HW_VERSION:    return 0x14;
+        case MARCSTATE:     return marcstate;
+        case RXBYTES:       return (fifo_len - fifo_rd) | ((marcstate == SIM_MARC_RXFIFO_OVERFLOW) ? 0x80 : 0);
+        case PKTSTATUS:     return gdo2 ? 0x04 : 0x00;
+        case RSSI:          return active_valid ? active.rssi_raw : 0x80;
+        case LQI:           return active_valid ? active.lqi_raw : 0x7f;
+        default:            return 0;
+    }
+}
+
+void CC1101_Sim::strobe(uint8_t cmd)
+{
+    switch (cmd) {
+        case SRES:
+            memset(regs, 0, sizeof(regs));
+            fifo_len = fifo_rd = 0;
+            // fall through
+        case SIDLE:
+            wor_on = 0;
+            if (active_valid) {                             // reception aborted
+                active_valid = 0;
+                frames_missed++;
+            }
+            gdo2 = 0;
+            marcstate = SIM_MARC_IDLE;
+            break;
+        case SRX:
+            if (marcstate == SIM_MARC_IDLE)
+                marcstate = SIM_MARC_RX;
+            break;
+        case SFRX:
+            if (marcstate == SIM_MARC_IDLE || marcstate == SIM_MARC_RXFIFO_OVERFLOW)
+                fifo_len = fifo_rd = 0;
+            break;
+        case SPWD:
+            if (marcstate == SIM_MARC_IDLE)
+                marcstate = SIM_MARC_SLEEP;
+            break;
+        case SWORRST:
+            wor_event_us = now_us;
+            break;
+        case SWOR:
+            if (marcstate == SIM_MARC_IDLE) {
+                marcstate = SIM_MARC_SLEEP;
+                wor_on = 1;
+                wor_next_us = wor_event_us + wor_event0_us();
+            }
+            break;
+        default:
+            break;
+    }
+}
+//-------------------------------[end]------------------------------------------
+
+//---------------------------[transport interface]------------------------------
+int CC1101_Sim::setup(void)
+{
+    return 0;
+}
+
+int CC1101_Sim::spi_begin(int /*speed*/)
+{
+    return 0;
+}
+
+void CC1101_Sim::spi_data_rw(uint8_t *data, int len)
+{
+    uint8_t header, addr, i;
+
+    if (len < 1)
+        return;
+    header = data[0];
+    addr = header & 0x3F;
+    data[0] = status_byte();
+    if (marcstate == SIM_MARC_SLEEP) {
+        marcstate = SIM_MARC_IDLE;                          // CSn low wakes the chip up
+        wor_on = 0;
+    }
+    if (addr >= SRES && addr <= SNOP) {
+        if ((header & READ_BURST) == READ_BURST) {
+            if (len > 1)
+                data[1] = read_status_reg(addr);
+        } else
+            strobe(addr);
+    } else if (addr == (PATABLE_BURST & 0x3F)) {
+        for(i = 1; i < len && i <= 8; i++)
+            if (header & READ_SINGLE_BYTE)
+                data[i] = patable[i-1];
+            else
+                patable[i-1] = data[i];
+    } else if (addr == (TXFIFO_BURST & 0x3F)) {
+        for(i = 1; i < len; i++)
+            if (header & READ_SINGLE_BYTE)
+                data[i] = (fifo_rd < fifo_len) ? fifo[fifo_rd++] : 0;
+    } else {
+        for(i = 1; i < len; i++)
+        {
+            addr = (header & WRITE_BURST) ? (header & 0x3F) + i - 1 : (header & 0x3F);
+            if (addr >= CFG_REGISTER)
+                break;
+            if (header & READ_SINGLE_BYTE)
+                data[i] = regs[addr];
+            else
+                regs[addr] = data[i];
+        }
+    }
+    if (fifo_rd && fifo_rd == fifo_len)
+        fifo_rd = fifo_len = 0;
+    advance(SIM_SPI_OVERHEAD_US + len);
+}
+
+void CC1101_Sim::pin_input(int /*pin*/)
+{
+}
+
+void CC1101_Sim::pin_write(int /*pin*/, uint8_t /*level*/)
+{
+}
+
+uint8_t CC1101_Sim::pin_read(int pin)
+{
+    advance(SIM_PIN_READ_US);
+    return (pin == GDO2) ? gdo2 : 0;
+}
+
+void CC1101_Sim::delay_ms(unsigned int ms)
+{
+    advance((uint64_t)ms * 1000);
+}
+
+void CC1101_Sim::delay_us(unsigned int us)
+{
+    advance(us);
+}
+
+unsigned int CC1101_Sim::millis(void)
+{
+    return (unsigned int)(now_us / 1000);
+}
+
+uint64_t CC1101_Sim::nanos(void)
+{
+    return now_us * 1000;
+}
+
+int CC1101_Sim::wait_gdo2(int timeout_ms, uint64_t *ts_ns)
+{
+    uint64_t deadline = now_us + (uint64_t)timeout_ms * 1000, next;
+    unsigned long received = frames_received;
+
+    while (now_us < deadline)
+    {
+        next = deadline;
+        if (active_valid && active.end_us < next)
+            next = active.end_us;
+        else if (!active_valid && num_frames && frames[num_frames-1].sync_us > now_us &&
+                frames[num_frames-1].sync_us < next)
+            next = frames[num_frames-1].sync_us;
+        if (wor_on && wor_next_us < next)
+            next = wor_next_us;
+        advance((next > now_us) ? next - now_us : 0);
+        if (frames_received != received) {
+            *ts_ns = now_us * 1000;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint8_t CC1101_Sim::exhausted(void)
+{
+    return now_us >= duration_us;
+}
+//-------------------------------[end]------------------------------------------
+
+void CC1101_Sim::check_reading(const oregon_data_t *r, unsigned int time_ms)
+{
+    sim_sensor_t *s;
+    uint64_t sent;
+    uint16_t no;
+    int i, k;
+
+    readings_checked++;
+    for(i = 0; i < num_sensors; i++)
+    {
+        s = &sensors[i];
+        if (s->sensor_id != r->sensor_id || s->channel != r->channel || s->roll_code != r->roll_code)
+            continue;
+        for(k = 0; k < SIM_SENT_LEN; k++)
+        {
+            sent = __atomic_load_n(&s->sent[k], __ATOMIC_ACQUIRE);
+            no = sent & 0xffff;
+            if (no == 0 || (int16_t)((sent >> 16) & 0xffff) != r->temp_dc ||
+                    abs((int32_t)(time_ms - (uint32_t)(sent >> 32))) > SIM_PUBLISH_MS)
+                continue;
+            // the messages of a sensor come out in order
+            if ((int16_t)(no - s->published_no) <= 0)
+                readings_twice++;
+            else
+                s->published_no = no;
+            return;
+        }
+        break;
+    }
+    readings_wrong++;
+}
+
+void CC1101_Sim::show_stats(void)
+{
+    printf("Simulated time [s]: %llu  sensors: %d\r\n", (unsigned long long)(now_us / 1000000), num_sensors);
+    printf("Sim frames sent/received/missed/collided/dropped: %lu / %lu / %lu / %lu / %lu\r\n",
+           frames_sent, frames_received, frames_missed, frames_collided, frames_dropped);
+    printf("Sim readings published/twice/not sent: %lu / %lu / %lu\r\n",
+           readings_checked, readings_twice, readings_wrong);
+    if (now_us)
+        printf("Sim radio RX/idle/sleep [%%]: %.1f / %.1f / %.1f  average current [mA]: %.3f\r\n",
+               100.0 * rx_us / now_us, 100.0 * idle_us / now_us, 100.0 * sleep_us / now_us,
+               (SIM_CURRENT_RX_MA * rx_us + SIM_CURRENT_IDLE_MA * idle_us + SIM_CURRENT_SLEEP_MA * sleep_us) / now_us);
+}
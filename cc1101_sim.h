@@ -0,0 +1,146 @@
+/*
+ * cc1101_sim.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  In-process simulated CC1101 with a generator of Oregon THN122N traffic.
+ *  Models MARCSTATE, RXBYTES, the RX FIFO (with appended RSSI/LQI) and GDO2
+ *  (asserted on sync word, de-asserted at end of packet) and Wake-on-Radio
+ *  with carrier sense (WOR_RES = 0 only) on a virtual clock -
+ *  delays advance the clock instead of sleeping, so the receive path runs
+ *  at full CPU speed.
+ */
+
+#ifndef CC1101_SIM_H_
+#define CC1101_SIM_H_
+
+#include <stdint.h>
+#include "cc1101_oregon.h"
+
+#define SIM_MAX_SENSORS		64
+#define SIM_MAX_FRAMES		256
+#define SIM_FIFO_SIZE		64
+#define SIM_BITRATE			2046	// from MDMCFG4/MDMCFG3 in cc1101_OOK_Oregon
+#define SIM_BURST_SPACING_MS	250		// sync to sync of the two bursts of a message
+#define SIM_LOOKAHEAD_MS	2000
+#define SIM_SPI_OVERHEAD_US	10
+#define SIM_PIN_READ_US		10
+#define SIM_DURATION_S		(24*3600)
+#define SIM_SYNC_SLIP_PCT	10		// frames whose sync is late or off the usual symbol grid
+#define SIM_PUBLISH_MS		2000	// the time of a reading is within this of the sync of its first burst
+#define SIM_SENT_LEN		32		// messages per sensor kept for the check - the receiver lags less
+// supply current per radio state (datasheet, 433 MHz, 3 V) - for the average shown
+#define SIM_CURRENT_RX_MA		15.5
+#define SIM_CURRENT_IDLE_MA		1.7
+#define SIM_CURRENT_SLEEP_MA	0.0002
+
+// MARCSTATE values used by the model
+#define SIM_MARC_SLEEP		0x00
+#define SIM_MARC_IDLE		0x01
+#define SIM_MARC_RX			0x0D
+#define SIM_MARC_RXFIFO_OVERFLOW	0x11
+
+typedef struct {
+	uint16_t sensor_id;
+	uint8_t  channel;
+	uint8_t  roll_code;
+	uint8_t  batt_low;
+	int16_t  temp_deci;
+	int8_t   rssi_dbm;
+	unsigned int period_ms;
+	uint64_t next_tx_us;
+	// the last messages sent (sync ms << 32 | temp << 16 | number) - the radio runs ahead of
+	// the publication, which checks its readings against them
+	uint64_t sent[SIM_SENT_LEN];
+	uint16_t sent_no;
+	uint16_t published_no;		// of the checker - the last message published
+} sim_sensor_t;
+
+typedef struct {
+	uint64_t sync_us, end_us;
+	uint8_t  data[SIM_FIFO_SIZE];
+	uint8_t  rssi_raw, lqi_raw;
+	uint8_t  corrupt;
+} sim_frame_t;
+
+class CC1101_Sim : public CC1101_Transport
+{
+    private:
+        uint64_t now_us, duration_us;
+        uint32_t rnd;
+        uint8_t regs[CFG_REGISTER], patable[8];
+        uint8_t marcstate, gdo2;
+        uint8_t fifo[SIM_FIFO_SIZE], fifo_len, fifo_rd;
+
+        sim_sensor_t sensors[SIM_MAX_SENSORS];
+        int num_sensors;
+        unsigned int bit_error_ppm;
+
+        sim_frame_t frames[SIM_MAX_FRAMES];     // scheduled, sorted by sync time
+        int num_frames;
+        sim_frame_t active;                     // frame being received
+        uint8_t active_valid;
+        uint8_t wor_on;                         // SWOR - sleeping or listening on the WOR timer
+        uint64_t wor_event_us, wor_next_us;     // last EVENT0, next EVENT0 or end of listening
+
+        uint32_t random(void);
+        int random_sync_bit(void);
+        void advance(uint64_t us);
+        void account(uint64_t us);
+        uint64_t bits_us(unsigned int bits) { return (uint64_t)bits * 1000000 / SIM_BITRATE; }
+        uint64_t wor_event0_us(void);
+        void wor_wakeup(void);
+        void run_events(void);
+        void schedule_traffic(void);
+        void queue_message(sim_sensor_t *s, uint64_t at_us);
+        void queue_frame(sim_frame_t *f);
+        void complete_frame(void);
+        void corrupt_frame(sim_frame_t *f, int from_bit, int bits);
+        void strobe(uint8_t cmd);
+        uint8_t status_byte(void);
+        uint8_t read_status_reg(uint8_t addr);
+
+    public:
+        unsigned long frames_sent, frames_received, frames_missed, frames_collided, frames_dropped;
+        unsigned long readings_checked, readings_twice, readings_wrong;
+        uint64_t rx_us, idle_us, sleep_us;      // virtual time the radio spent in each state
+
+        CC1101_Sim();
+
+        int add_sensor(uint16_t sensor_id, uint8_t channel, uint8_t roll_code, int16_t temp_deci,
+                       unsigned int period_ms, unsigned int phase_ms, int8_t rssi_dbm);
+        void add_thn122n_sensors(int num);
+        void set_duration(unsigned int sec) { duration_us = (uint64_t)sec * 1000000; }
+        void set_bit_errors(unsigned int ppm) { bit_error_ppm = ppm; }
+        void show_stats(void);
+        // a good reading published by the receiver at time_ms - it must be of a message sent,
+        // and no message may be published twice. Called by one thread, maybe not the radio's.
+        void check_reading(const oregon_data_t *r, unsigned int time_ms);
+
+        int setup(void);
+        int spi_begin(int speed);
+        void spi_data_rw(uint8_t *data, int len);
+
+        void pin_input(int pin);
+        void pin_write(int pin, uint8_t level);
+        uint8_t pin_read(int pin);
+
+        void delay_ms(unsigned int ms);
+        void delay_us(unsigned int us);
+        unsigned int millis(void);
+        uint64_t nanos(void);
+
+        // simulated edge source - the clock jumps straight to the next end of packet
+        int gdo2_events_begin(const char * /*chip*/, unsigned int /*line*/) { return 0; }
+        int wait_gdo2(int timeout_ms, uint64_t *ts_ns);
+
+        uint8_t exhausted(void);
+};
+
+// THN122N/THN132N payload (sensor bytes as returned by oregon_decode, incl. checksum)
+void oregon_sim_thn122n_payload(uint16_t sensor_id, uint8_t channel, uint8_t roll_code,
+                                uint8_t batt_low, int16_t temp_deci, uint8_t payload[8]);
+// Manchester/double-bit encode a payload into raw FIFO bytes with the sync nibble at sync_bit
+void oregon_sim_encode(const uint8_t *payload, uint8_t plen, int sync_bit, uint8_t *fifo, uint8_t fifolen);
+
+#endif /* CC1101_SIM_H_ */
@@ -0,0 +1,193 @@
+/*
+ * cc1101_transport.cpp
+ *
+ *  Created on: 17Oct.,2026
+ */
+
+#include "cc1101_transport.h"
+#include <string.h>
+
+#if !CC1101_NO_WIRINGPI
+#include <wiringPi.h>
+#include <wiringPiSPI.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+#include <linux/gpio.h>
+#include <sys/epoll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#endif
+
+int CC1101_SPI_Batch::add(uint8_t header, const uint8_t *data, uint8_t len)
+{
+    if (segs >= SPI_BATCH_MAX_SEGS || used + 1 + len > SPI_BATCH_MAX_BYTES)
+        return -1;
+    seg_start[segs] = used;
+    seg_len[segs] = 1 + len;
+    buf[used] = header;
+    if (data)
+        memcpy(buf + used + 1, data, len);
+    else
+        memset(buf + used + 1, 0, len);
+    used += 1 + len;
+    return segs++;
+}
+
+void CC1101_Transport::spi_transfer(CC1101_SPI_Batch &batch)
+{
+    for(int i = 0; i < batch.num_segments(); i++)
+        spi_data_rw(batch.segment(i), batch.segment_len(i));
+}
+
+#if !CC1101_NO_WIRINGPI
+
+int CC1101_WiringPi::setup(void)
+{
+    return wiringPiSetup();
+}
+
+int CC1101_WiringPi::spi_begin(int speed)
+{
+    return wiringPiSPISetup(CC1101_SPI_CHANNEL, speed);
+}
+
+void CC1101_WiringPi::spi_data_rw(uint8_t *data, int len)
+{
+    wiringPiSPIDataRW(CC1101_SPI_CHANNEL, data, len);
+}
+
+void CC1101_WiringPi::spi_transfer(CC1101_SPI_Batch &batch)
+{
+    struct spi_ioc_transfer xfer[SPI_BATCH_MAX_SEGS];
+    int i, n = batch.num_segments();
+
+    if (n == 0)
+        return;
+    memset(xfer, 0, sizeof(xfer));
+    for(i = 0; i < n; i++)
+    {
+        xfer[i].tx_buf = xfer[i].rx_buf = (unsigned long)batch.segment(i);
+        xfer[i].len = batch.segment_len(i);
+        xfer[i].speed_hz = CC1101_SPI_SPEED;
+        xfer[i].bits_per_word = 8;
+        xfer[i].cs_change = (i < n - 1);        // every access is its own CSn frame
+    }
+    if (ioctl(wiringPiSPIGetFd(CC1101_SPI_CHANNEL), SPI_IOC_MESSAGE(n), xfer) < 0)
+        CC1101_Transport::spi_transfer(batch);  // spidev refused - one access at a time
+}
+
+void CC1101_WiringPi::pin_input(int pin)
+{
+    pinMode(pin, INPUT);
+}
+
+void CC1101_WiringPi::pin_write(int pin, uint8_t level)
+{
+    digitalWrite(pin, level ? HIGH : LOW);
+}
+
+uint8_t CC1101_WiringPi::pin_read(int pin)
+{
+    return digitalRead(pin);
+}
+
+void CC1101_WiringPi::delay_ms(unsigned int ms)
+{
+    delay(ms);
+}
+
+void CC1101_WiringPi::delay_us(unsigned int us)
+{
+    delayMicroseconds(us);
+}
+
+unsigned int CC1101_WiringPi::millis(void)
+{
+    return ::millis();
+}
+
+uint64_t CC1101_WiringPi::nanos(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//--------------------[GDO2 edge events - /dev/gpiochipN]------------------------
+int CC1101_WiringPi::gdo2_events_begin(const char *chip, unsigned int line)
+{
+    struct gpio_v2_line_request req;
+    struct epoll_event ev;
+    int chip_fd;
+
+    if ((chip_fd = open(chip, O_RDONLY | O_CLOEXEC)) < 0)
+        return -1;
+    memset(&req, 0, sizeof(req));
+    req.offsets[0] = line;
+    req.num_lines = 1;
+    strncpy(req.consumer, "oregon_cc1101", sizeof(req.consumer) - 1);
+    // both edges: rising = sync word, falling = end of packet; kernel timestamps are CLOCK_MONOTONIC
+    req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    req.event_buffer_size = 16;
+    if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+        close(chip_fd);
+        return -1;
+    }
+    close(chip_fd);
+    gdo2_fd = req.fd;
+    if ((epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+        gdo2_events_end();
+        return -1;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = gdo2_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, gdo2_fd, &ev) < 0) {
+        gdo2_events_end();
+        return -1;
+    }
+    return 0;
+}
+
+void CC1101_WiringPi::gdo2_events_end(void)
+{
+    if (epoll_fd >= 0)
+        close(epoll_fd);
+    if (gdo2_fd >= 0)
+        close(gdo2_fd);
+    epoll_fd = gdo2_fd = -1;
+}
+
+int CC1101_WiringPi::wait_gdo2(int timeout_ms, uint64_t *ts_ns)
+{
+    struct epoll_event ev;
+    struct gpio_v2_line_event le[16];
+    int i, n;
+    ssize_t r;
+
+    if (epoll_fd < 0)
+        return -1;
+    for(;;)
+    {
+        n = epoll_wait(epoll_fd, &ev, 1, timeout_ms);
+        if (n <= 0)
+            return (n < 0 && errno != EINTR) ? -1 : 0;      // timeout or signal
+        if ((r = read(gdo2_fd, le, sizeof(le))) <= 0)
+            return (r < 0 && errno != EINTR && errno != EAGAIN) ? -1 : 0;
+        // several edges may be queued - the last falling one ends the packet
+        n = 0;
+        for(i = 0; i < (int)(r / sizeof(le[0])); i++)
+            if (le[i].id == GPIO_V2_LINE_EVENT_FALLING_EDGE) {
+                *ts_ns = le[i].timestamp_ns;
+                n = 1;
+            }
+        if (n)
+            return 1;
+        // only the sync word so far - the packet end follows within ~200 ms
+    }
+}
+//-------------------------------[end]------------------------------------------
+#endif
@@ -0,0 +1,116 @@
+/*
+ * cc1101_transport.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  SPI/GPIO access used by CC1101_Oregon. The radio class never calls
+ *  wiringPi directly - it goes through one of the transports below, so the
+ *  whole Rx path can also run against the simulated chip in cc1101_sim.h.
+ */
+
+#ifndef CC1101_TRANSPORT_H_
+#define CC1101_TRANSPORT_H_
+
+#include <stdint.h>
+
+// build without wiringPi (simulated radio only) - set by 'make SIM=1'
+#ifndef CC1101_NO_WIRINGPI
+#define CC1101_NO_WIRINGPI	0
+#endif
+
+#define CC1101_SPI_CHANNEL	0
+#define CC1101_SPI_SPEED	8000000
+
+#define SPI_BATCH_MAX_SEGS	8
+#define SPI_BATCH_MAX_BYTES	96
+
+//------------[SPI transaction - several CSn-framed accesses in one go]----------
+class CC1101_SPI_Batch
+{
+    private:
+        uint8_t buf[SPI_BATCH_MAX_BYTES];
+        uint8_t seg_start[SPI_BATCH_MAX_SEGS], seg_len[SPI_BATCH_MAX_SEGS];
+        uint8_t segs, used;
+
+        int add(uint8_t header, const uint8_t *data, uint8_t len);
+
+    public:
+        CC1101_SPI_Batch() { clear(); }
+
+        void clear(void) { segs = used = 0; }
+        // queue an access, returns its segment index (-1 if the batch is full)
+        int strobe(uint8_t cmd) { return add(cmd, 0, 0); }
+        int read_register(uint8_t addr) { return add(addr | 0x80, 0, 1); }        // single read (or status reg)
+        int read_burst(uint8_t addr, uint8_t len) { return add(addr | 0xC0, 0, len); }
+        int write_register(uint8_t addr, uint8_t value) { return add(addr, &value, 1); }
+
+        uint8_t num_segments(void) { return segs; }
+        uint8_t *segment(int seg) { return buf + seg_start[seg]; }     // header + data, full duplex
+        uint8_t segment_len(int seg) { return seg_len[seg]; }
+        // results after the transfer
+        uint8_t status(int seg) { return buf[seg_start[seg]]; }        // chip status byte
+        uint8_t *data(int seg) { return buf + seg_start[seg] + 1; }
+};
+
+class CC1101_Transport
+{
+    public:
+        virtual ~CC1101_Transport() {}
+
+        virtual int setup(void) = 0;                       // GPIO library setup
+        virtual int spi_begin(int speed) = 0;
+        virtual void spi_data_rw(uint8_t *data, int len) = 0;   // full duplex, in place
+        // all segments of the batch, CSn released between them; by default one access at a time
+        virtual void spi_transfer(CC1101_SPI_Batch &batch);
+
+        virtual void pin_input(int pin) = 0;
+        virtual void pin_write(int pin, uint8_t level) = 0;
+        virtual uint8_t pin_read(int pin) = 0;
+
+        virtual void delay_ms(unsigned int ms) = 0;
+        virtual void delay_us(unsigned int us) = 0;
+        virtual unsigned int millis(void) = 0;
+        virtual uint64_t nanos(void) = 0;                  // on the clock of the wait_gdo2() timestamps
+
+        // GDO2 edge events instead of polling: begin returns <0 if not supported,
+        // wait returns 1 on end of packet (falling edge, timestamp in ns), 0 on timeout
+        virtual int gdo2_events_begin(const char * /*chip*/, unsigned int /*line*/) { return -1; }
+        virtual void gdo2_events_end(void) {}
+        virtual int wait_gdo2(int /*timeout_ms*/, uint64_t * /*ts_ns*/) { return -1; }
+
+        // TRUE when a finite source (e.g. the simulator) has nothing more to give
+        virtual uint8_t exhausted(void) { return 0; }
+};
+
+#if !CC1101_NO_WIRINGPI
+//------------------[wiringPi backend - real radio on the Pi]--------------------
+class CC1101_WiringPi : public CC1101_Transport
+{
+    private:
+        int gdo2_fd, epoll_fd;
+
+    public:
+        CC1101_WiringPi() : gdo2_fd(-1), epoll_fd(-1) {}
+
+        int setup(void);
+        int spi_begin(int speed);
+        void spi_data_rw(uint8_t *data, int len);
+        void spi_transfer(CC1101_SPI_Batch &batch);     // single SPI_IOC_MESSAGE ioctl
+
+        void pin_input(int pin);
+        void pin_write(int pin, uint8_t level);
+        uint8_t pin_read(int pin);
+
+        void delay_ms(unsigned int ms);
+        void delay_us(unsigned int us);
+        unsigned int millis(void);
+        uint64_t nanos(void);                              // CLOCK_MONOTONIC
+
+        // GPIO character device line events, waited for on an epoll fd
+        int gdo2_events_begin(const char *chip, unsigned int line);
+        void gdo2_events_end(void);
+        int wait_gdo2(int timeout_ms, uint64_t *ts_ns);
+};
+#endif
+
+#endif /* CC1101_TRANSPORT_H_ */
@@ -0,0 +1,159 @@
+/*
+ * oregon_archive.cpp
+ *
+ *  Created on: 17Oct.,2026
+ */
+
+#include "oregon_archive.h"
+#include <string.h>
+#include <stddef.h>
+#include <sched.h>
+
+#define READ_SPINS	100		// reader retries before yielding the CPU
+
+static const uint32_t tier_len[OREGON_AR_TIERS] = { OREGON_AR_RAW_LEN, OREGON_AR_5MIN_LEN, OREGON_AR_HOUR_LEN };
+static const uint32_t tier_step[OREGON_AR_TIERS] = { 0, 300, 3600 };
+
+static unsigned int sensor_hash(uint16_t id, uint8_t chan)
+{
+	uint32_t key = ((uint32_t)id << 8) | chan;
+
+	return ((key * 0x9E3779B1u) >> 16) % OREGON_ARCHIVE_SENSORS;
+}
+
+static oregon_ar_row_t *tier_rows(oregon_ar_sensor_t *s, int tier)
+{
+	return (tier == OREGON_AR_5MIN) ? s->min5 : s->hour;
+}
+
+uint32_t oregon_archive_tier_len(int tier)
+{
+	return tier_len[tier];
+}
+
+uint32_t oregon_archive_tier_step(int tier)
+{
+	return tier_step[tier];
+}
+
+// the file is created zeroed (sparse) - only the header is written
+void oregon_archive_init(oregon_archive_t *ar)
+{
+	ar->magic = OREGON_ARCHIVE_MAGIC;
+	ar->version = OREGON_ARCHIVE_VERSION;
+	ar->header_size = offsetof(oregon_archive_t, sensors);
+	ar->archive_size = sizeof(oregon_archive_t);
+}
+
+int oregon_archive_valid(const oregon_archive_t *ar, uint64_t size)
+{
+	return size >= sizeof(oregon_archive_t) && ar->magic == OREGON_ARCHIVE_MAGIC &&
+			ar->version == OREGON_ARCHIVE_VERSION && ar->header_size == offsetof(oregon_archive_t, sensors) &&
+			ar->archive_size == sizeof(oregon_archive_t);
+}
+
+void oregon_archive_add(oregon_archive_t *ar, const oregon_data_t *r)
+{
+	oregon_ar_sensor_t *s = NULL, *oldest = NULL;
+	oregon_ar_row_t *row;
+	uint32_t period;
+	unsigned int i, h;
+	int t;
+
+	h = sensor_hash(r->sensor_id, r->channel);
+	for(i = 0; i < OREGON_ARCHIVE_SENSORS; i++) {
+		s = &ar->sensors[(h + i) % OREGON_ARCHIVE_SENSORS];
+		if (!s->used || (s->sensor_id == r->sensor_id && s->channel == r->channel))
+			break;
+		if (!oldest || s->last_time < oldest->last_time)
+			oldest = s;
+	}
+	__atomic_store_n(&ar->seq, ar->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	if (i == OREGON_ARCHIVE_SENSORS || !s->used) {
+		// full - the least recently updated sensor makes room, its slot stays in use
+		if (i == OREGON_ARCHIVE_SENSORS)
+			s = oldest;
+		s->sensor_id = r->sensor_id;
+		s->channel = r->channel;
+		memset(s->head, 0, sizeof(s->head));
+		s->used = 1;
+	}
+	s->last_time = r->time;
+	s->raw[s->head[OREGON_AR_RAW] % OREGON_AR_RAW_LEN] = *r;
+	s->head[OREGON_AR_RAW]++;
+	for(t = OREGON_AR_5MIN; t < OREGON_AR_TIERS; t++) {
+		period = r->time - r->time % tier_step[t];
+		row = &tier_rows(s, t)[(s->head[t] + tier_len[t] - 1) % tier_len[t]];
+		if (!s->head[t] || row->time != period) {
+			row = &tier_rows(s, t)[s->head[t] % tier_len[t]];
+			row->time = period;
+			row->min_dc = row->max_dc = r->temp_dc;
+			row->sum_dc = 0;
+			row->count = 0;
+			s->head[t]++;
+		}
+		if (r->temp_dc < row->min_dc)
+			row->min_dc = r->temp_dc;
+		if (r->temp_dc > row->max_dc)
+			row->max_dc = r->temp_dc;
+		row->sum_dc += r->temp_dc;
+		row->count++;
+	}
+	__atomic_store_n(&ar->seq, ar->seq + 1, __ATOMIC_RELEASE);
+}
+
+int oregon_archive_find(const oregon_archive_t *ar, long id, long chan, int from)
+{
+	const oregon_ar_sensor_t *s;
+	int i;
+
+	for(i = from; i < OREGON_ARCHIVE_SENSORS; i++) {
+		s = &ar->sensors[i];
+		if (s->used && (id < 0 || s->sensor_id == id) && (chan < 0 || s->channel == chan))
+			return i;
+	}
+	return -1;
+}
+
+// every entry is copied under the seqlock; one overwritten meanwhile by a newer one
+// (the reader lapped), or all after the slot went to another sensor, are left out
+uint32_t oregon_archive_read(const oregon_archive_t *ar, int slot, int tier, uint32_t from, uint32_t to,
+		void *out, uint32_t max)
+{
+	const oregon_ar_sensor_t *s = &ar->sensors[slot];
+	const uint8_t *ring = (tier == OREGON_AR_RAW) ? (const uint8_t *)s->raw :
+			(const uint8_t *)tier_rows((oregon_ar_sensor_t *)s, tier);
+	size_t size = (tier == OREGON_AR_RAW) ? sizeof(oregon_data_t) : sizeof(oregon_ar_row_t);
+	uint8_t entry[sizeof(oregon_ar_row_t)];
+	uint64_t head, i;
+	uint32_t seq1, seq2, time, n = 0;
+	uint16_t id = s->sensor_id;
+	uint8_t chan = s->channel;
+	int ok, tries;
+
+	head = __atomic_load_n(&s->head[tier], __ATOMIC_ACQUIRE);
+	for(i = (head > tier_len[tier]) ? head - tier_len[tier] : 0; i < head && n < max; i++) {
+		tries = 0;
+		do {
+			if (++tries > READ_SPINS)
+				sched_yield();
+			seq1 = __atomic_load_n(&ar->seq, __ATOMIC_ACQUIRE);
+			if (seq1 & 1)
+				continue;
+			memcpy(entry, ring + (i % tier_len[tier]) * size, size);
+			ok = s->head[tier] - i <= tier_len[tier] && s->sensor_id == id && s->channel == chan;
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			seq2 = __atomic_load_n(&ar->seq, __ATOMIC_RELAXED);
+		} while ((seq1 & 1) || seq1 != seq2);
+		if (!ok) {
+			if (s->sensor_id != id || s->channel != chan)
+				break;
+			continue;
+		}
+		time = (tier == OREGON_AR_RAW) ? ((oregon_data_t *)entry)->time : ((oregon_ar_row_t *)entry)->time;
+		if (time >= from && time <= to)
+			memcpy((uint8_t *)out + n++ * size, entry, size);
+	}
+	return n;
+}
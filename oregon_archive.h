@@ -0,0 +1,80 @@
+/*
+ * oregon_archive.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  Round-robin archive of the readings, as kept by 'oregon_read -A' in a mapped
+ *  file: per sensor (ID and channel, so a battery change keeps the series) the
+ *  raw readings, and min/avg/max temperature per 5 minutes and per hour. Every
+ *  tier is a fixed ring, so adding a reading is constant time and the file never
+ *  grows. One writer; readers copy rows under the archive seqlock.
+ *  No I/O here - the caller maps the file.
+ */
+
+#ifndef OREGON_ARCHIVE_H_
+#define OREGON_ARCHIVE_H_
+
+#include <stdint.h>
+#include "oregon_decoder.h"
+
+#define OREGON_ARCHIVE_MAGIC	0x4843524f	// "ORCH" little endian
+#define OREGON_ARCHIVE_VERSION	1
+#define OREGON_ARCHIVE_SENSORS	32
+
+// tiers
+#define OREGON_AR_RAW			0
+#define OREGON_AR_5MIN			1
+#define OREGON_AR_HOUR			2
+#define OREGON_AR_TIERS			3
+
+#define OREGON_AR_RAW_LEN		8192	// readings, ~3.8 days of a THN122N
+#define OREGON_AR_5MIN_LEN		4032	// 2 weeks
+#define OREGON_AR_HOUR_LEN		8784	// a leap year
+
+typedef struct {
+	uint32_t time;				// start of the period, s since epoch
+	int16_t  min_dc, max_dc;	// [0.1 degC]
+	int32_t  sum_dc;
+	uint16_t count;				// readings in the period
+	uint16_t reserved;
+} oregon_ar_row_t;
+
+typedef struct {
+	uint16_t sensor_id;
+	uint8_t  channel;
+	uint8_t  used;
+	uint32_t last_time;			// of the last reading - the oldest one is replaced when full
+	uint64_t head[OREGON_AR_TIERS];	// entries ever written to each ring
+	oregon_data_t raw[OREGON_AR_RAW_LEN];
+	oregon_ar_row_t min5[OREGON_AR_5MIN_LEN];
+	oregon_ar_row_t hour[OREGON_AR_HOUR_LEN];
+} oregon_ar_sensor_t;
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t header_size;		// offsetof(oregon_archive_t, sensors)
+	uint32_t archive_size;		// sizeof(oregon_archive_t)
+	uint32_t seq;				// odd while the writer updates
+	uint32_t reserved[2];
+	oregon_ar_sensor_t sensors[OREGON_ARCHIVE_SENSORS];
+} oregon_archive_t;
+
+static_assert(sizeof(oregon_ar_row_t) == 16, "archive row layout");
+static_assert(sizeof(oregon_ar_sensor_t) % 8 == 0, "archive sensor layout");
+
+// a fresh archive; valid - the mapping of size bytes is an archive of this version
+void oregon_archive_init(oregon_archive_t *ar);
+int oregon_archive_valid(const oregon_archive_t *ar, uint64_t size);
+// the writer: reading r to all tiers of its sensor
+void oregon_archive_add(oregon_archive_t *ar, const oregon_data_t *r);
+// slot of the sensor with this ID and channel (-1 - any) from slot 'from' on, -1 if none
+int oregon_archive_find(const oregon_archive_t *ar, long id, long chan, int from);
+// entries of a tier with from <= time <= to, oldest first, at most max. Raw readings go
+// to out as oregon_data_t, the others as oregon_ar_row_t
+uint32_t oregon_archive_read(const oregon_archive_t *ar, int slot, int tier, uint32_t from, uint32_t to,
+		void *out, uint32_t max);
+uint32_t oregon_archive_tier_len(int tier);
+uint32_t oregon_archive_tier_step(int tier);	// s per row, 0 - raw
+
+#endif /* OREGON_ARCHIVE_H_ */
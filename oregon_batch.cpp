@@ -0,0 +1,478 @@
+/*
+ * oregon_batch.cpp
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  Offline decoder for capture files written by 'oregon_read -C'. Every file
+ *  is mapped read-only and split at quiet gaps into chunks, which a pool of
+ *  threads run through the same burst reassembler as the receiver; the chunk
+ *  results are merged in file order, so the statistics match the receiver's
+ *  exactly. Readings go to stdout as CSV, statistics to stderr.
+ *  Build with 'make batch'.
+ */
+
+#include "oregon_decoder.h"
+#include "oregon_capture.h"
+#include "oregon_reasm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BATCH_MAX_THREADS	64
+#define BATCH_CHUNKS_PER_THREAD	8		// smaller chunks - better balance
+#define BATCH_MIN_CHUNK		256			// records
+
+#define BATCH_MAX_SENSORS	32			// as the receiver's sensor table
+
+#define PARANOID_NEEDS_BOTH_MESSAGES	0	// as in oregon_read.cpp, -p sets it
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#define ABS(a) ( (a) < 0 ? (-(a)) : (a) )
+
+// the first and last good reading of a sensor in a chunk - the intervals are between
+// readings of the same sensor, also across a chunk border
+typedef struct {
+	uint16_t sensor_id;
+	uint8_t channel, roll_code;
+	uint32_t first_ms, last_ms;
+	int16_t first_temp, last_temp;
+} batch_sensor_t;
+
+// the receiver statistics (struct INSTANCE of oregon_read.cpp) plus what is needed to
+// merge chunks
+typedef struct {
+	unsigned long total_reads;
+	unsigned long good_reads;
+	unsigned int  min_intvl, max_intvl;
+	unsigned int brst1_errors, brst2_errors, mbrst_errors, pktlen_errors, buffmatch_errors, chksum_errors;
+	unsigned long sync_hits[OREGON_SYNC_NOT_FOUND+1];
+	unsigned long combined_reads;
+	int	max_temp_diff;		// [0.1 degC]
+	long	rssi_sum;
+	unsigned long	lqi_sum;
+	uint8_t lqi_max, lqi_min;
+	int8_t rssi_max, rssi_min;
+	int nsensors;
+	batch_sensor_t sensors[BATCH_MAX_SENSORS];
+} batch_stats_t;
+
+typedef struct {
+	const char *path;
+	const oregon_cap_record_t *rec;
+	size_t begin, end;				// records of this chunk
+	batch_stats_t stats;
+	char *out;						// CSV lines
+	size_t out_len;
+} batch_chunk_t;
+
+typedef struct {
+	batch_chunk_t *chunks;
+	int nchunks;
+	int next;						// next chunk to take, atomic
+} batch_job_t;
+
+int quiet = 0;
+int need_both = PARANOID_NEEDS_BOTH_MESSAGES;
+
+void stats_init(batch_stats_t *st)
+{
+	memset(st, 0, sizeof(*st));
+	st->min_intvl = 0xffff;
+	st->lqi_min = 127;
+	st->rssi_max = -128;
+	st->rssi_min = 127;
+}
+
+// seconds between good readings, rounded as the receiver does
+unsigned int intvl_s(uint32_t from_ms, uint32_t to_ms)
+{
+	uint32_t diff = to_ms - from_ms;
+	return diff/1000 + (diff % 1000)/500;
+}
+
+// the entry of a sensor, a new one if there is room (else NULL - the sensor then adds
+// no intervals, as one evicted from the receiver's table)
+batch_sensor_t *stats_sensor(batch_stats_t *st, uint16_t sensor_id, uint8_t channel, uint8_t roll_code, int *added)
+{
+	batch_sensor_t *s;
+	int i;
+
+	*added = 0;
+	for(i = 0; i < st->nsensors; i++) {
+		s = &st->sensors[i];
+		if (s->sensor_id == sensor_id && s->channel == channel && s->roll_code == roll_code)
+			return s;
+	}
+	if (st->nsensors == BATCH_MAX_SENSORS)
+		return NULL;
+	s = &st->sensors[st->nsensors++];
+	s->sensor_id = sensor_id;
+	s->channel = channel;
+	s->roll_code = roll_code;
+	*added = 1;
+	return s;
+}
+
+void stats_intvl(batch_stats_t *st, batch_sensor_t *s, uint32_t time_ms, int16_t temp_dc)
+{
+	st->min_intvl = MIN(st->min_intvl, intvl_s(s->last_ms, time_ms));
+	st->max_intvl = MAX(st->max_intvl, intvl_s(s->last_ms, time_ms));
+	st->max_temp_diff = MAX(ABS(temp_dc - s->last_temp), st->max_temp_diff);
+}
+
+void stats_good(batch_stats_t *st, const oregon_message_t *msg, uint32_t time_ms)
+{
+	const oregon_data_t *od = &msg->reading;
+	batch_sensor_t *s;
+	int added;
+
+	st->good_reads++;
+	if (msg->combined)
+		st->combined_reads++;
+	s = stats_sensor(st, od->sensor_id, od->channel, od->roll_code, &added);
+	if (s) {
+		if (!added)
+			stats_intvl(st, s, time_ms, od->temp_dc);
+		else {
+			s->first_ms = time_ms;
+			s->first_temp = od->temp_dc;
+		}
+		s->last_ms = time_ms;
+		s->last_temp = od->temp_dc;
+	}
+	st->rssi_sum += (msg->rssi_dbm1 + msg->rssi_dbm2)/2;
+	st->lqi_sum += (msg->lqi1 + msg->lqi2)/2;
+	st->rssi_min = MIN(MIN(msg->rssi_dbm1, msg->rssi_dbm2), st->rssi_min);
+	st->rssi_max = MAX(MAX(msg->rssi_dbm1, msg->rssi_dbm2), st->rssi_max);
+	st->lqi_max = MAX(MAX(msg->lqi1, msg->lqi2), st->lqi_max);
+	st->lqi_min = MIN(MIN(msg->lqi1, msg->lqi2), st->lqi_min);
+}
+
+// append the statistics of the chunk that follows in time
+void stats_merge(batch_stats_t *st, const batch_stats_t *next)
+{
+	const batch_sensor_t *n;
+	batch_sensor_t *s;
+	int i, added;
+
+	for(i = 0; i < next->nsensors; i++) {
+		n = &next->sensors[i];
+		s = stats_sensor(st, n->sensor_id, n->channel, n->roll_code, &added);
+		if (!s)
+			continue;
+		if (!added)
+			stats_intvl(st, s, n->first_ms, n->first_temp);
+		else {
+			s->first_ms = n->first_ms;
+			s->first_temp = n->first_temp;
+		}
+		s->last_ms = n->last_ms;
+		s->last_temp = n->last_temp;
+	}
+	st->total_reads += next->total_reads;
+	st->good_reads += next->good_reads;
+	st->min_intvl = MIN(st->min_intvl, next->min_intvl);
+	st->max_intvl = MAX(st->max_intvl, next->max_intvl);
+	st->brst1_errors += next->brst1_errors;
+	st->brst2_errors += next->brst2_errors;
+	st->mbrst_errors += next->mbrst_errors;
+	st->pktlen_errors += next->pktlen_errors;
+	st->buffmatch_errors += next->buffmatch_errors;
+	st->chksum_errors += next->chksum_errors;
+	for(i = 0; i <= OREGON_SYNC_NOT_FOUND; i++)
+		st->sync_hits[i] += next->sync_hits[i];
+	st->combined_reads += next->combined_reads;
+	st->max_temp_diff = MAX(st->max_temp_diff, next->max_temp_diff);
+	st->rssi_sum += next->rssi_sum;
+	st->lqi_sum += next->lqi_sum;
+	st->lqi_max = MAX(st->lqi_max, next->lqi_max);
+	st->lqi_min = MIN(st->lqi_min, next->lqi_min);
+	st->rssi_max = MAX(st->rssi_max, next->rssi_max);
+	st->rssi_min = MIN(st->rssi_min, next->rssi_min);
+}
+
+void stats_print(const char *name, const batch_stats_t *st)
+{
+	fprintf(stderr, "\n=== %s ===\n", name);
+	fprintf(stderr, "Bad/Total received Oregon packets:           %lu / %lu\n", st->total_reads - st->good_reads, st->total_reads);
+	fprintf(stderr, "Errors: brst1 / brst2 / mburst:              %u / %u / %u\n", st->brst1_errors, st->brst2_errors, st->mbrst_errors);
+	fprintf(stderr, "Errors: pktlen / bfmatch / chksum:           %u / %u / %u\n", st->pktlen_errors, st->buffmatch_errors, st->chksum_errors);
+	fprintf(stderr, "Good packets rebuilt from 2 bad bursts:       %lu\n", st->combined_reads);
+	fprintf(stderr, "Sync @ bit offset 0..7 / not found:          %lu %lu %lu %lu %lu %lu %lu %lu / %lu\n",
+			st->sync_hits[0], st->sync_hits[1], st->sync_hits[2], st->sync_hits[3], st->sync_hits[4],
+			st->sync_hits[5], st->sync_hits[6], st->sync_hits[7], st->sync_hits[OREGON_SYNC_NOT_FOUND]);
+	if (st->min_intvl <= st->max_intvl) {
+		fprintf(stderr, "Min/Max time between good packets [s]:       %u / %u\n", st->min_intvl, st->max_intvl);
+		fprintf(stderr, "Max T variation between updates [degC]:      %.1f\n", OREGON_TEMP_C(st->max_temp_diff));
+	}
+	if (st->good_reads > 0) {
+		fprintf(stderr, "Min/Average/Max RSSI (good packets) [dBm]:  %d / %ld / %d\n", st->rssi_min, st->rssi_sum / (long)st->good_reads, st->rssi_max);
+		fprintf(stderr, "Max/Average/Min LQI (good packets):          %u / %lu / %u\n", st->lqi_max, st->lqi_sum / st->good_reads, st->lqi_min);
+	}
+}
+
+void record_raw(const oregon_cap_record_t *rec, oregon_raw_t *raw)
+{
+	raw->len = MIN(rec->len, OREGON_RAW_MAX);
+	memcpy(raw->data, rec->data, raw->len);
+	raw->rssi_raw = rec->rssi_raw;
+	raw->lqi_raw = rec->lqi_raw;
+	raw->sync_pos = 0;
+	raw->sync_offset = OREGON_SYNC_NO_SEARCH;
+}
+
+void stats_message(batch_stats_t *st, const oregon_reasm_msg_t *m, FILE *out, const char *path)
+{
+	const oregon_message_t *msg = &m->msg;
+
+	st->total_reads++;
+	if (msg->good) {
+		stats_good(st, msg, m->time_ms);
+		if (out)
+			fprintf(out, "%s,%u,0x%04X,%u,0x%02X,%u,%.1f,%d,%u,%u\n", path, m->time_ms,
+					msg->reading.sensor_id, msg->reading.channel, msg->reading.roll_code,
+					msg->reading.batt_low, OREGON_TEMP_C(msg->reading.temp_dc),
+					msg->reading.rssi_dbm, msg->reading.lqi, msg->combined);
+	}
+	if (!msg->res1)
+		st->brst1_errors++;
+	if (!msg->res2)
+		st->brst2_errors++;
+	if (msg->pktlen < THN122N_MIN_PKTLEN_FOR_DECODE)
+		st->pktlen_errors++;
+	if (msg->buffdiff)
+		st->buffmatch_errors++;
+	if (!msg->cksum_ok)
+		st->chksum_errors++;
+}
+
+//-----------------------[replay of the receiver decode thread]-----------------
+void decode_chunk(batch_chunk_t *ch)
+{
+	const oregon_cap_record_t *rec;
+	oregon_reasm_t reasm;
+	oregon_reasm_msg_t done[OREGON_REASM_SLOTS];
+	oregon_raw_t raw;
+	FILE *out = NULL;
+	uint8_t role, sync_offset;
+	size_t i;
+	int k, n;
+
+	stats_init(&ch->stats);
+	oregon_reasm_init(&reasm, need_both);
+	if (!quiet)
+		out = open_memstream(&ch->out, &ch->out_len);
+	for(i = ch->begin; i < ch->end; i++) {
+		rec = &ch->rec[i];
+		record_raw(rec, &raw);
+		n = oregon_reasm_add(&reasm, &raw, rec->time_ms, 0, &role, &sync_offset, done);
+		if (sync_offset != OREGON_SYNC_NO_SEARCH)
+			ch->stats.sync_hits[sync_offset]++;
+		if (role == OREGON_REASM_SPURIOUS) {
+			ch->stats.total_reads++;
+			ch->stats.mbrst_errors++;
+		}
+		for(k = 0; k < n; k++)
+			stats_message(&ch->stats, &done[k], out, ch->path);
+	}
+	n = oregon_reasm_flush(&reasm, done);
+	for(k = 0; k < n; k++)
+		stats_message(&ch->stats, &done[k], out, ch->path);
+	if (out)
+		fclose(out);
+}
+//-------------------------------[end]------------------------------------------
+
+void *worker(void *arg)
+{
+	batch_job_t *job = (batch_job_t *)arg;
+	int k;
+
+	while ((k = __sync_fetch_and_add(&job->next, 1)) < job->nchunks)
+		decode_chunk(&job->chunks[k]);
+	return NULL;
+}
+
+// split only where no burst came for longer than the reassembler timeout - every
+// message is complete or timed out by then, so the chunks do not depend on each other
+int make_chunks(const char *path, const oregon_cap_record_t *rec, size_t n, int want, batch_chunk_t *chunks)
+{
+	size_t step = MAX(n / want + 1, (size_t)BATCH_MIN_CHUNK);
+	size_t begin = 0, end;
+	int k = 0;
+
+	while (begin < n) {
+		end = MIN(begin + step, n);
+		while (end < n && (uint32_t)(rec[end].time_ms - rec[end - 1].time_ms) <= OREGON_REASM_TIMEOUT_MS)
+			end++;
+		memset(&chunks[k], 0, sizeof(chunks[k]));
+		chunks[k].path = path;
+		chunks[k].rec = rec;
+		chunks[k].begin = begin;
+		chunks[k].end = end;
+		k++;
+		begin = end;
+	}
+	return k;
+}
+
+int decode_file(const char *path, int nthreads, batch_stats_t *total)
+{
+	const oregon_cap_header_t *hdr;
+	const oregon_cap_record_t *rec;
+	pthread_t threads[BATCH_MAX_THREADS];
+	batch_chunk_t *chunks;
+	batch_job_t job;
+	batch_stats_t st;
+	struct timespec t0, t1;
+	struct stat sb;
+	void *map;
+	size_t n;
+	double wall_s;
+	int fd, k;
+
+	if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &sb) < 0) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		if (fd >= 0)
+			close(fd);
+		return 0;
+	}
+	if (sb.st_size < (off_t)sizeof(oregon_cap_header_t)) {
+		fprintf(stderr, "%s: not a capture file\n", path);
+		close(fd);
+		return 0;
+	}
+	map = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return 0;
+	}
+	hdr = (const oregon_cap_header_t *)map;
+	if (hdr->magic != OREGON_CAP_MAGIC || hdr->version != OREGON_CAP_VERSION ||
+			hdr->record_size != sizeof(oregon_cap_record_t)) {
+		fprintf(stderr, "%s: not a capture file (or another version)\n", path);
+		munmap(map, sb.st_size);
+		return 0;
+	}
+	madvise(map, sb.st_size, MADV_SEQUENTIAL);
+	rec = (const oregon_cap_record_t *)(hdr + 1);
+	n = (sb.st_size - sizeof(*hdr)) / sizeof(*rec);
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	chunks = (batch_chunk_t *)malloc((n / BATCH_MIN_CHUNK + 1) * sizeof(batch_chunk_t));
+	job.chunks = chunks;
+	job.nchunks = make_chunks(path, rec, n, nthreads * BATCH_CHUNKS_PER_THREAD, chunks);
+	job.next = 0;
+	nthreads = MIN(nthreads, job.nchunks);
+	for(k = 1; k < nthreads; k++)
+		if (pthread_create(&threads[k], NULL, worker, &job) != 0) {
+			nthreads = k;
+			break;
+		}
+	worker(&job);
+	for(k = 1; k < nthreads; k++)
+		pthread_join(threads[k], NULL);
+
+	stats_init(&st);
+	for(k = 0; k < job.nchunks; k++) {
+		if (chunks[k].out) {
+			fwrite(chunks[k].out, 1, chunks[k].out_len, stdout);
+			free(chunks[k].out);
+		}
+		stats_merge(&st, &chunks[k].stats);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	wall_s = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+	stats_print(path, &st);
+	fprintf(stderr, "Records / threads / wall time [s]:           %lu / %d / %.3f  (%.0f frames/s)\n",
+			(unsigned long)n, MAX(nthreads, 1), wall_s, (wall_s > 0) ? n / wall_s : 0.0);
+	stats_merge(total, &st);
+	free(chunks);
+	munmap(map, sb.st_size);
+	return 1;
+}
+
+int capture_filter(const struct dirent *d)
+{
+	return d->d_name[0] != '.';
+}
+
+int decode_path(const char *path, int nthreads, batch_stats_t *total)
+{
+	struct dirent **names;
+	struct stat sb;
+	char file[PATH_MAX];
+	int i, n, files = 0;
+
+	if (stat(path, &sb) < 0 || !S_ISDIR(sb.st_mode))
+		return decode_file(path, nthreads, total);
+	if ((n = scandir(path, &names, capture_filter, alphasort)) < 0) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return 0;
+	}
+	for(i = 0; i < n; i++) {
+		snprintf(file, sizeof(file), "%s/%s", path, names[i]->d_name);
+		if (stat(file, &sb) == 0 && S_ISREG(sb.st_mode))
+			files += decode_file(file, nthreads, total);
+		free(names[i]);
+	}
+	free(names);
+	return files;
+}
+
+void usage(const char *name)
+{
+	fprintf(stderr, "USAGE: %s [-j threads] [-p] [-q] file|dir ...\n", name);
+	fprintf(stderr, "         -j threads  decoding threads (default: online CPUs, max %d)\n", BATCH_MAX_THREADS);
+	fprintf(stderr, "         -p          only accept messages with both bursts decoded the same\n");
+	fprintf(stderr, "         -q          statistics only, no readings on stdout\n");
+}
+
+int main(int argc, char *argv[])
+{
+	batch_stats_t total;
+	int c, i, files = 0;
+	int nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	while ((c = getopt(argc, argv, "j:pqh")) != -1) {
+		switch (c) {
+		case 'j':
+			nthreads = atoi(optarg);
+			break;
+		case 'p':
+			need_both = 1;
+			break;
+		case 'q':
+			quiet = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (optind >= argc || nthreads <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+	nthreads = MIN(nthreads, BATCH_MAX_THREADS);
+	if (!quiet)
+		printf("file,time_ms,id,channel,roll,batt,temp,rssi,lqi,combined\n");
+	stats_init(&total);
+	for(i = optind; i < argc; i++)
+		files += decode_path(argv[i], nthreads, &total);
+	if (files > 1)
+		stats_print("All files", &total);
+	return files ? 0 : 1;
+}
@@ -0,0 +1,373 @@
+/*
+ * oregon_bench.cpp
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  Decode microbenchmark - runs every symbol kernel usable on this CPU over
+ *  synthetic FIFO captures and random buffers, checks the results are
+ *  bit-identical to the original bit loop and reports the cost per frame.
+ *  Also checks the sync correlator and oregon_decode_frame end to end. With
+ *  -C the bursts of 'oregon_read -C' capture files go through the same check
+ *  as the synthetic frames. Build with 'make bench'.
+ */
+
+#include "cc1101_oregon.h"
+#include "cc1101_sim.h"
+#include "oregon_symbols.h"
+#include "oregon_decoder.h"
+#include "oregon_capture.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_FRAMES	4096
+#define BENCH_ROUNDS	200
+#define BENCH_PKTLEN	41		// cc1101_OOK_Oregon PKTLEN
+#define BENCH_RANDOM	100000	// random buffers for the differential check
+#define BENCH_MAXSYM	127		// longest random symbol run (two FIFOs)
+#define BENCH_MAX_CAPS	16		// -C files
+
+typedef struct {
+	uint8_t raw[FIFOBUFFER];
+	uint8_t len;					// FIFO bytes
+	uint8_t pos, offset_bits;
+} bench_frame_t;
+
+typedef uint8_t (*decode_fn)(uint8_t *rxbuffer, uint8_t pos, uint8_t &pktlen, uint8_t offset_bits);
+
+static uint32_t rnd = 0x9E3779B9;
+
+static uint32_t bench_random(void)
+{
+	rnd ^= rnd << 13;
+	rnd ^= rnd >> 17;
+	rnd ^= rnd << 5;
+	return rnd;
+}
+
+// the original per-bit loops of CC1101_Oregon::oregon_decode, kept as the reference
+static uint8_t ref_realign(const uint8_t *src, uint8_t n, uint8_t offset_bits, uint8_t *dst)
+{
+	uint16_t curr_window;
+	uint8_t i;
+
+	for(i = 0 ; i < n; i++)
+	{
+		curr_window = (src[i] << 8) + src[i+1];
+		dst[i] = ((curr_window >> (8-offset_bits)) & 0xFF);
+		if (dst[i] != 0x99 && dst[i] != 0x96 && dst[i] != 0x69 && dst[i] != 0x66)
+			return i;
+	}
+	return n;
+}
+
+static void ref_decode(const uint8_t *sym, uint8_t nbytes, uint8_t *out)
+{
+	uint32_t curr_window32;
+	uint8_t i,j;
+
+	for(i = 0 ; i < nbytes; i++)
+	{
+		curr_window32 = (sym[i*4] << 8) + sym[i*4+1] + (sym[i*4+2] << 24) + (sym[i*4+3] << 16);
+		out[i] = 0;
+		for (j=0; j < 8; j++) {
+			out[i] = (out[i] << 1) + (((curr_window32 & 0xf)==0x6)?1:0);
+			curr_window32 >>=  4;
+		}
+	}
+}
+
+static uint8_t decode_loop(uint8_t *rxbuffer, uint8_t pos, uint8_t &pktlen, uint8_t offset_bits)
+{
+	uint8_t *rxbuffer_loc = rxbuffer+pos;
+
+	if (ref_realign(rxbuffer_loc, pktlen-1, offset_bits, rxbuffer_loc) != pktlen-1)
+		return FALSE;
+	if (rxbuffer_loc[0] != 0x96 || rxbuffer_loc[1] != 0x96)
+		return FALSE;
+	pktlen = (pktlen - 3) / 4;
+	ref_decode(rxbuffer_loc + 2, pktlen, rxbuffer);
+	return TRUE;
+}
+
+static uint8_t decode_lut(uint8_t *rxbuffer, uint8_t pos, uint8_t &pktlen, uint8_t offset_bits)
+{
+	uint8_t *rxbuffer_loc = rxbuffer+pos;
+
+	if (oregon_sym_realign(rxbuffer_loc, pktlen-1, offset_bits, rxbuffer_loc) != pktlen-1)
+		return FALSE;
+	if (rxbuffer_loc[0] != 0x96 || rxbuffer_loc[1] != 0x96)
+		return FALSE;
+	pktlen = (pktlen - 3) / 4;
+	oregon_sym_decode(rxbuffer_loc + 2, pktlen, rxbuffer);
+	return TRUE;
+}
+
+static void make_frames(bench_frame_t *frames, int num)
+{
+	uint8_t payload[8];
+	int i, k, sync_bit;
+
+	for(i = 0; i < num; i++)
+	{
+		for(k = 0; k < 8; k++)
+			payload[k] = bench_random();
+		sync_bit = 3 + 4 * (bench_random() % 9);
+		memset(frames[i].raw, 0, FIFOBUFFER);
+		oregon_sim_encode(payload, sizeof(payload), sync_bit, frames[i].raw, BENCH_PKTLEN);
+		frames[i].len = BENCH_PKTLEN;
+		frames[i].pos = sync_bit / 8;
+		frames[i].offset_bits = sync_bit % 8;
+		// every 8th frame gets a bit error, so the reject path is exercised as well
+		if ((i & 7) == 7) {
+			k = bench_random() % (BENCH_PKTLEN * 8);
+			frames[i].raw[k / 8] ^= 0x80 >> (k % 8);
+		}
+	}
+}
+
+// the bursts of a capture file that have a sync - the ones the receiver decodes symbols of
+static int load_capture(const char *path, bench_frame_t **frames, int *num)
+{
+	oregon_cap_header_t hdr;
+	oregon_cap_record_t rec;
+	bench_frame_t *f;
+	int total = 0, max = *num;
+	FILE *fp;
+
+	if ((fp = fopen(path, "rb")) == NULL) {
+		perror(path);
+		return 0;
+	}
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || hdr.magic != OREGON_CAP_MAGIC ||
+			hdr.version != OREGON_CAP_VERSION || hdr.record_size != sizeof(rec)) {
+		fprintf(stderr, "%s: not a capture file (or another version)\n", path);
+		fclose(fp);
+		return 0;
+	}
+	while (fread(&rec, sizeof(rec), 1, fp) == 1)
+	{
+		total++;
+		if (rec.len < OREGON_MIN_RAW_LEN || rec.len > OREGON_RAW_MAX)
+			continue;
+		if (*num == max) {
+			max = max ? 2 * max : BENCH_FRAMES;
+			*frames = (bench_frame_t *)realloc(*frames, max * sizeof(bench_frame_t));
+		}
+		f = &(*frames)[*num];
+		memset(f->raw, 0, FIFOBUFFER);
+		memcpy(f->raw, rec.data, rec.len);
+		f->len = rec.len;
+		// the sync as oregon_decode_frame looks for it
+		if (!oregon_sync_find(f->raw + THN122N_START_SEARCH_AT, f->len - THN122N_START_SEARCH_AT, f->pos, f->offset_bits))
+			continue;
+		f->pos += THN122N_START_SEARCH_AT;
+		if (f->len < f->pos + 4)
+			continue;
+		(*num)++;
+	}
+	fclose(fp);
+	printf("%s: %d bursts\n", path, total);
+	return 1;
+}
+
+static int check(bench_frame_t *frames, int num, decode_fn fn, const char *name, const char *what)
+{
+	uint8_t a[FIFOBUFFER], b[FIFOBUFFER], la, lb, ra, rb;
+	int i, bad = 0;
+
+	for(i = 0; i < num; i++)
+	{
+		memcpy(a, frames[i].raw, FIFOBUFFER);
+		memcpy(b, frames[i].raw, FIFOBUFFER);
+		la = lb = frames[i].len - frames[i].pos;
+		ra = decode_loop(a, frames[i].pos, la, frames[i].offset_bits);
+		rb = fn(b, frames[i].pos, lb, frames[i].offset_bits);
+		if (ra != rb || (ra && (la != lb || memcmp(a, b, la))))
+			bad++;
+	}
+	printf("%-8s %d / %d %s differ from the bit loop\n", name, bad, num, what);
+	return bad;
+}
+
+// random buffers (half of them valid symbol runs with a few flipped bits), every length and offset
+static int check_random(int num, const char *name)
+{
+	static const uint8_t syms[4] = {0x99, 0x96, 0x69, 0x66};
+	uint8_t src[BENCH_MAXSYM + 1], a[BENCH_MAXSYM], b[BENCH_MAXSYM];
+	uint8_t n, off, ra, rb;
+	int i, k, bad = 0;
+
+	for(i = 0; i < num; i++)
+	{
+		n = bench_random() % (BENCH_MAXSYM + 1);
+		off = bench_random() % 8;
+		for(k = 0; k <= BENCH_MAXSYM; k++)
+			src[k] = (i & 1) ? syms[bench_random() % 4] : bench_random();
+		// the valid runs are already aligned - shift them back so realign restores them
+		if (i & 1) {
+			for(k = BENCH_MAXSYM; k > 0; k--)
+				src[k] = (src[k] >> off) | (src[k-1] << (8 - off));
+			src[0] >>= off;
+			if (bench_random() % 4 == 0) {
+				k = bench_random() % ((BENCH_MAXSYM + 1) * 8);
+				src[k / 8] ^= 0x80 >> (k % 8);
+			}
+		}
+		memset(a, 0, sizeof(a));
+		memset(b, 0, sizeof(b));
+		ra = ref_realign(src, n, off, a);
+		rb = oregon_sym_realign(src, n, off, b);
+		if (ra != rb || memcmp(a, b, sizeof(a))) {
+			bad++;
+			continue;
+		}
+		if (ra == n) {
+			ref_decode(a, n / 4, a);
+			oregon_sym_decode(b, n / 4, b);
+			if (memcmp(a, b, n / 4))
+				bad++;
+		}
+	}
+	printf("%-8s %d / %d random buffers differ from the bit loop\n", name, bad, num);
+	return bad;
+}
+
+// the correlator must find the sync at every bit position a 41 byte FIFO can hold a frame from
+static int check_sync(const char *name)
+{
+	uint8_t payload[8], raw[FIFOBUFFER], pos, off;
+	int p, k, bad = 0, num = 0;
+
+	for(p = 0; p <= 48; p++)
+		for(k = 0; k < 64; k++, num++)
+		{
+			for(int j = 0; j < 8; j++)
+				payload[j] = bench_random();
+			oregon_sim_encode(payload, sizeof(payload), p, raw, BENCH_PKTLEN);
+			if (!oregon_sync_find(raw, BENCH_PKTLEN, pos, off) || pos * 8 + off != p)
+				bad++;
+		}
+	printf("%-8s %d / %d sync positions missed\n", name, bad, num);
+	return bad;
+}
+
+// whole frames through oregon_decode_frame: clean ones must give back the reading,
+// ones with a bit flipped in the decoded part must not pass as good
+static int check_decoder(int num, const char *name)
+{
+	uint8_t payload[8], raw[FIFOBUFFER];
+	uint8_t channel, roll, batt;
+	int16_t temp;
+	oregon_frame_t frame;
+	oregon_err_t err;
+	int i, k, flip, bad = 0;
+
+	for(i = 0; i < num; i++)
+	{
+		channel = 1 + bench_random() % 3;
+		roll = bench_random();
+		batt = bench_random() & 1;
+		temp = (int)(bench_random() % 1200) - 600;
+		oregon_sim_thn122n_payload(0xEC40, channel, roll, batt, temp, payload);
+		oregon_sim_encode(payload, sizeof(payload), 3 + 4 * (bench_random() % 9), raw, BENCH_PKTLEN);
+		flip = i & 1;
+		if (flip) {
+			k = 64 + bench_random() % (28 * 8);		// inside the symbols of the ID..checksum
+			raw[k / 8] ^= 0x80 >> (k % 8);
+		}
+		err = oregon_decode_frame(raw, BENCH_PKTLEN, 0x80, 0x2A, &frame);
+		if (flip) {
+			if (err == OREGON_OK)
+				bad++;
+		} else if (err != OREGON_OK || frame.reading.channel != channel || frame.reading.roll_code != roll ||
+				frame.reading.batt_low != batt || frame.reading.temp_dc != temp ||
+				frame.reading.lqi != 0x2A)
+			bad++;
+	}
+	printf("%-8s %d / %d frames decoded wrong\n", name, bad, num);
+	return bad;
+}
+
+static double bench(bench_frame_t *frames, int num, int rounds, decode_fn fn, unsigned long *sink)
+{
+	uint8_t buf[FIFOBUFFER], len;
+	struct timespec t0, t1;
+	int r, i;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for(r = 0; r < rounds; r++)
+		for(i = 0; i < num; i++)
+		{
+			memcpy(buf, frames[i].raw, FIFOBUFFER);
+			len = frames[i].len - frames[i].pos;
+			if (fn(buf, frames[i].pos, len, frames[i].offset_bits))
+				*sink += buf[0] + buf[len-1];
+		}
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / ((double)rounds * num);
+}
+
+int main(int argc, char *argv[])
+{
+	static const char *kernels[] = {"scalar", "sse2", "avx2", "neon"};
+	const char *caps[BENCH_MAX_CAPS];
+	bench_frame_t *frames, *captured = NULL;
+	unsigned long sink = 0;
+	double t_loop, t;
+	int num, rounds, ncaps = 0, ncaptured = 0;
+	int c, k, bad = 0;
+
+	while ((c = getopt(argc, argv, "C:h")) != -1) {
+		switch (c) {
+		case 'C':
+			if (ncaps < BENCH_MAX_CAPS) {
+				caps[ncaps++] = optarg;
+				break;
+			}
+			// fall through
+		default:
+			fprintf(stderr, "USAGE: %s [ -C file]... [frames] [rounds]\n", argv[0]);
+			return 1;
+		}
+	}
+	num = (argc > optind) ? atoi(argv[optind]) : BENCH_FRAMES;
+	rounds = (argc > optind + 1) ? atoi(argv[optind + 1]) : BENCH_ROUNDS;
+	if (num <= 0 || rounds <= 0) {
+		fprintf(stderr, "USAGE: %s [ -C file]... [frames] [rounds]\n", argv[0]);
+		return 1;
+	}
+	frames = (bench_frame_t *)malloc(num * sizeof(bench_frame_t));
+	make_frames(frames, num);
+	for(k = 0; k < ncaps; k++)
+		if (!load_capture(caps[k], &captured, &ncaptured))
+			return 1;
+	if (ncaps)
+		printf("captured %d bursts with a sync\n", ncaptured);
+
+	bad += check_sync("sync");
+	bad += check_decoder(BENCH_FRAMES, "decoder");
+	t_loop = bench(frames, num, rounds, decode_loop, &sink);
+	printf("%-8s %8.1f ns/frame\n", "loop", t_loop);
+	for(k = 0; k < (int)(sizeof(kernels) / sizeof(kernels[0])); k++)
+	{
+		if (!oregon_sym_select(kernels[k])) {
+			printf("%-8s not available\n", kernels[k]);
+			continue;
+		}
+		bad += check(frames, num, decode_lut, kernels[k], "frames");
+		if (ncaptured)
+			bad += check(captured, ncaptured, decode_lut, kernels[k], "captured bursts");
+		bad += check_random(BENCH_RANDOM, kernels[k]);
+		t = bench(frames, num, rounds, decode_lut, &sink);
+		printf("%-8s %8.1f ns/frame  (x%.2f)\n", kernels[k], t, t_loop / t);
+	}
+	oregon_sym_select(NULL);
+	printf("default kernel: %s  (checksum %lu)\n", oregon_sym_kernel(), sink);
+
+	free(frames);
+	free(captured);
+	return bad ? 1 : 0;
+}
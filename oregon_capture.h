@@ -0,0 +1,46 @@
+/*
+ * oregon_capture.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  Capture file of raw cc1101 FIFO bursts, as written by 'oregon_read -C' and
+ *  read by oregon_batch: a header, then fixed-size records in Rx order, so a
+ *  file can be mapped and split at any quiet gap.
+ */
+
+#ifndef OREGON_CAPTURE_H_
+#define OREGON_CAPTURE_H_
+
+#include <stdint.h>
+#include "oregon_decoder.h"
+
+#define OREGON_CAP_MAGIC		0x50414343	// "CCAP" little endian
+#define OREGON_CAP_VERSION		1
+
+// role of a burst in its message, as the receiver's reassembler saw it (oregon_batch
+// reassembles the bursts again and does not rely on it)
+#define OREGON_CAP_SLOT_FIRST	1			// first burst of a message (or a spurious one)
+#define OREGON_CAP_SLOT_SECOND	2			// second burst - the message is judged here
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t record_size;					// sizeof(oregon_cap_record_t)
+	uint32_t reserved[2];
+} oregon_cap_header_t;
+
+typedef struct {
+	uint32_t time_ms;						// Rx time (millis() of the receiver)
+	uint8_t  slot;							// OREGON_CAP_SLOT_*
+	uint8_t  burst;							// burst number within the message, 0 - first, 2 - spurious
+	uint8_t  len;							// FIFO bytes without RSSI and LQI, 0 - read failed
+	uint8_t  rssi_raw, lqi_raw;
+	uint8_t  reserved[3];
+	uint8_t  data[OREGON_RAW_MAX];
+	uint8_t  pad[10];
+} oregon_cap_record_t;
+
+static_assert(sizeof(oregon_cap_header_t) == 16, "capture header layout");
+static_assert(sizeof(oregon_cap_record_t) == 88, "capture record layout");
+
+#endif /* OREGON_CAPTURE_H_ */
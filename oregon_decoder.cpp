@@ -0,0 +1,271 @@
+/*
+ * oregon_decoder.cpp
+ *
+ *  Created on: 17Oct.,2026
+ */
+
+#include "oregon_decoder.h"
+#include "oregon_symbols.h"
+#include <string.h>
+
+//--------------------------[RSSI and LQI]--------------------------------------
+int8_t oregon_rssi_dbm(uint8_t rssi_raw)
+{
+    int16_t rssi_dec = rssi_raw;
+
+    if (rssi_dec >= 128)
+        rssi_dec -= 256;
+    return (rssi_dec / 2) - OREGON_RSSI_OFFSET;
+}
+
+uint8_t oregon_lqi(uint8_t lqi_raw)
+{
+    return (lqi_raw & 0x7F);
+}
+//-------------------------------[end]------------------------------------------
+
+//--------------------------[symbols to bytes]----------------------------------
+oregon_err_t oregon_decode_symbols(const uint8_t *fifo, uint8_t len, uint8_t pos, uint8_t offset_bits, uint8_t *out, uint8_t &outlen)
+{
+    uint8_t sym[OREGON_RAW_MAX];
+    uint8_t n;
+
+    if (len < pos + 3 || len - pos > OREGON_RAW_MAX)
+        return OREGON_ERR_SHORT;
+    // shift with offset_bits (reads one byte ahead), every byte must be a valid symbol pair
+    n = len - pos - 1;
+    if (oregon_sym_realign(fifo + pos, n, offset_bits, sym) != n)
+        return OREGON_ERR_SYMBOL;
+    if (sym[0] != 0x96 || sym[1] != 0x96)
+        return OREGON_ERR_NO_SYNC;
+    // manchester and double-bit decode, 4 symbol bytes per output byte
+    outlen = (len - pos - 3) / 4;
+    oregon_sym_decode(sym + 2, outlen, out);
+    return OREGON_OK;
+}
+//-------------------------------[end]------------------------------------------
+
+//--------------------------[THN122N/THN132N fields]----------------------------
+uint8_t oregon_thn122n_checksum_ok(const uint8_t *data)
+{
+    uint16_t checksum = 0;
+    uint8_t i;
+
+    for(i = 0 ; i < 6; i++)
+        checksum += (data[i] >> 4) + (data[i] & 0xf);
+    // if checksum larger than 0xff, add upper byte bits to lower byte
+    checksum = ((checksum & 0xff) + (checksum >> 8)) & 0xff;
+    // invert checksum nibbles
+    checksum = (checksum >> 4) + ((checksum << 4) & 0xf0);
+    return (checksum == data[6]);
+}
+
+oregon_err_t oregon_parse_thn122n(const uint8_t *data, uint8_t len, oregon_data_t *reading)
+{
+    uint8_t chn, i;
+    int16_t temp_dc;
+
+    if (len < THN122N_PKTLEN_USED_DECODE)
+        return OREGON_ERR_PKTLEN;
+    // for the moment decoding only THN122N/THN132N sensors!
+    if (data[0] != 0xEC || data[1] != 0x40)
+        return OREGON_ERR_ID;
+    reading->sensor_id = (data[0] << 8) + data[1];
+    reading->cksum_ok = oregon_thn122n_checksum_ok(data);
+    reading->batt_low = (data[3] & 0x4) >> 2;
+    temp_dc = ((data[5] & 0xf0) >> 4) * 100 + (data[4] & 0xf) * 10 + ((data[4] & 0xf0) >> 4);
+    if (data[5] & 0xf)
+        temp_dc = -temp_dc;
+    reading->temp_dc = temp_dc;
+    // channel is one-hot in the high nibble
+    chn = (data[2] & 0xf0) >> 4;
+    for(i = 1 ; i < 5; i++) {
+        chn >>= 1;
+        if (!chn)
+            break;
+    }
+    reading->channel = i;
+    reading->roll_code = ((data[2] & 0xf) << 4) + ((data[3] & 0xf0) >> 4);
+    return reading->cksum_ok ? OREGON_OK : OREGON_ERR_CHECKSUM;
+}
+//-------------------------------[end]------------------------------------------
+
+//--------------------------[FIFO to reading]-----------------------------------
+oregon_err_t oregon_decode_frame(const uint8_t *fifo, uint8_t len, uint8_t rssi_raw, uint8_t lqi_raw, oregon_frame_t *frame)
+{
+    oregon_err_t err;
+
+    memset(frame, 0, sizeof(*frame));
+    frame->sync_offset = OREGON_SYNC_NO_SEARCH;
+    frame->reading.rssi_dbm = oregon_rssi_dbm(rssi_raw);
+    frame->reading.lqi = oregon_lqi(lqi_raw);
+    if (len < OREGON_MIN_RAW_LEN || len > OREGON_RAW_MAX)
+        return OREGON_ERR_SHORT;
+#if THN122N_CHECK_CC_IN_BUF
+    // check if first 2 bytes are CC
+    if (fifo[0] != 0xCC || fifo[1] != 0xCC)
+        return OREGON_ERR_NO_SYNC;
+#endif
+    // sync nibble start - any bit offset, anywhere in the buffer
+    frame->sync_score = oregon_sync_find(fifo + THN122N_START_SEARCH_AT, len - THN122N_START_SEARCH_AT,
+            frame->sync_pos, frame->sync_offset);
+    if (!frame->sync_score) {
+        frame->sync_pos = 0;
+        frame->sync_offset = OREGON_SYNC_NOT_FOUND;
+        return OREGON_ERR_NO_SYNC;
+    }
+    frame->sync_pos += THN122N_START_SEARCH_AT;
+    if ((err = oregon_decode_symbols(fifo, len, frame->sync_pos, frame->sync_offset, frame->data, frame->len)) != OREGON_OK)
+        return err;
+    if (frame->len < THN122N_MIN_PKTLEN_FOR_DECODE)
+        return OREGON_ERR_PKTLEN;
+    return oregon_parse_thn122n(frame->data, frame->len, &frame->reading);
+}
+//-------------------------------[end]------------------------------------------
+
+//-------------------[combine two bursts that failed]---------------------------
+// realign a kept burst to its sync, invalid symbol bytes included;
+// returns the number of symbol bytes after the sync nibble, 0 if there is no sync
+static uint8_t raw_symbols(const oregon_raw_t *raw, uint8_t sym[])
+{
+    uint8_t i, n;
+
+    if (raw->len == 0 || raw->len > OREGON_RAW_MAX || raw->sync_offset >= OREGON_SYNC_NOT_FOUND ||
+            raw->len < raw->sync_pos + 4)
+        return 0;
+    n = raw->len - raw->sync_pos - 1;
+    for(i = 0; i < n; i++)
+        i += oregon_sym_realign(raw->data + raw->sync_pos + i, n - i, raw->sync_offset, sym + i);
+    return n - 2;
+}
+
+oregon_err_t oregon_combine_raw(const oregon_raw_t *raw1, const oregon_raw_t *raw2, oregon_frame_t *frame)
+{
+    uint8_t sym1[OREGON_RAW_MAX], sym2[OREGON_RAW_MAX];
+    const uint8_t *s1 = sym1 + 2, *s2 = sym2 + 2;       // skip the sync nibble
+    uint8_t n, n2, i, nib, nib1, nib2, pass;
+
+    memset(frame, 0, sizeof(*frame));
+    frame->sync_offset = OREGON_SYNC_NO_SEARCH;
+    n = raw_symbols(raw1, sym1);
+    n2 = raw_symbols(raw2, sym2);
+    if (!n || !n2)
+        return OREGON_ERR_NO_SYNC;
+    n = ((n < n2) ? n : n2) / 4;
+    if (n < THN122N_MIN_PKTLEN_FOR_DECODE)
+        return OREGON_ERR_PKTLEN;
+    // every nibble from the burst where its two symbol bytes are valid; where both are
+    // valid but differ, first trust burst 1 and then burst 2 - the checksum decides
+    for(pass = 0; pass < 2; pass++)
+    {
+        for(i = 0; i < n * 2; i++)
+        {
+            nib1 = oregon_nibble_lut[(s1[i*2] << 8) + s1[i*2+1]];
+            nib2 = oregon_nibble_lut[(s2[i*2] << 8) + s2[i*2+1]];
+            if (nib1 & OREGON_SYM_INVALID)
+                nib = nib2;
+            else if ((nib2 & OREGON_SYM_INVALID) || nib1 == nib2)
+                nib = nib1;
+            else {
+                frame->conflicts += !pass;
+                nib = pass ? nib2 : nib1;
+            }
+            // only what is decoded must be valid, the rest is postamble
+            if ((nib & OREGON_SYM_INVALID) && i < THN122N_PKTLEN_USED_DECODE * 2)
+                return OREGON_ERR_SYMBOL;
+            nib &= 0xf;
+            if (i & 1)
+                frame->data[i/2] = (frame->data[i/2] & 0xf0) + nib;
+            else
+                frame->data[i/2] = nib << 4;
+        }
+        if (oregon_thn122n_checksum_ok(frame->data)) {
+            frame->len = n;
+            return oregon_parse_thn122n(frame->data, frame->len, &frame->reading);
+        }
+        if (!frame->conflicts)
+            break;
+    }
+    frame->len = n;
+    return OREGON_ERR_CHECKSUM;
+}
+//-------------------------------[end]------------------------------------------
+
+//------------------------[both bursts of a message]----------------------------
+void oregon_decode_message(const oregon_raw_t *raw1, const oregon_raw_t *raw2, int need_both, oregon_message_t *msg)
+{
+    oregon_frame_t combined;
+    oregon_raw_t r1, r2;
+    const uint8_t *data;
+    oregon_err_t err;
+
+    memset(msg, 0, sizeof(*msg));
+    msg->cksum_ok = 1;
+    msg->res1 = OREGON_BURST_OK(oregon_decode_frame(raw1->data, raw1->len, raw1->rssi_raw, raw1->lqi_raw, &msg->frame1));
+    msg->res2 = OREGON_BURST_OK(oregon_decode_frame(raw2->data, raw2->len, raw2->rssi_raw, raw2->lqi_raw, &msg->frame2));
+    msg->rssi_dbm1 = msg->frame1.reading.rssi_dbm;
+    msg->rssi_dbm2 = msg->frame2.reading.rssi_dbm;
+    msg->lqi1 = msg->frame1.reading.lqi;
+    msg->lqi2 = msg->frame2.reading.lqi;
+    // both bursts bad - try to rebuild the frame from the valid symbols of each
+    // (with the sync found just now, so the caller does not have to fill it in)
+    if (!msg->res1 && !msg->res2) {
+        r1 = *raw1;
+        r2 = *raw2;
+        r1.sync_pos = msg->frame1.sync_pos;
+        r1.sync_offset = msg->frame1.sync_offset;
+        r2.sync_pos = msg->frame2.sync_pos;
+        r2.sync_offset = msg->frame2.sync_offset;
+        msg->combined = (oregon_combine_raw(&r1, &r2, &combined) == OREGON_OK);
+        msg->conflicts = combined.conflicts;
+    }
+    // sometimes decoded data can span a bit longer - cap the pktlen in case 2 bursts are OK
+    // else just take the pktlen of the good burst, and 0 if both bursts are bad
+    if (msg->res1 && msg->res2) {
+        msg->pktlen = (msg->frame1.len < msg->frame2.len) ? msg->frame1.len : msg->frame2.len;
+        data = msg->frame2.data;
+        // compare only the decoded part
+        msg->buffdiff = memcmp(msg->frame1.data, msg->frame2.data,
+                (msg->pktlen < THN122N_PKTLEN_USED_DECODE) ? msg->pktlen : THN122N_PKTLEN_USED_DECODE) != 0;
+    } else if (msg->combined) {
+        msg->pktlen = combined.len;
+        data = combined.data;
+    } else {
+        msg->pktlen = msg->res1 ? msg->frame1.len : msg->frame2.len;
+        data = msg->res1 ? msg->frame1.data : msg->frame2.data;
+        if (!need_both) {
+            msg->rssi_dbm1 = msg->rssi_dbm2 = msg->res1 ? msg->rssi_dbm1 : msg->rssi_dbm2;
+            msg->lqi1 = msg->lqi2 = msg->res1 ? msg->lqi1 : msg->lqi2;
+        }
+    }
+    // a combined frame is checksum-verified already
+    if (need_both) {
+        if (!((msg->res1 && msg->res2 && !msg->buffdiff) || msg->combined))
+            return;
+    } else if (!(msg->res1 || msg->res2 || msg->combined))
+        return;
+    if (msg->pktlen < THN122N_MIN_PKTLEN_FOR_DECODE)
+        return;
+    err = oregon_parse_thn122n(data, msg->pktlen, &msg->reading);
+    if (err == OREGON_ERR_ID || err == OREGON_ERR_PKTLEN)
+        return;
+    msg->cksum_ok = msg->reading.cksum_ok;
+    msg->good = msg->cksum_ok;
+    msg->reading.rssi_dbm = (msg->rssi_dbm1 < msg->rssi_dbm2) ? msg->rssi_dbm1 : msg->rssi_dbm2;
+    msg->reading.lqi = (msg->lqi1 > msg->lqi2) ? msg->lqi1 : msg->lqi2;
+}
+//-------------------------------[end]------------------------------------------
+
+const char *oregon_strerror(oregon_err_t err)
+{
+    switch (err) {
+    case OREGON_OK:             return "OK";
+    case OREGON_ERR_SHORT:      return "Packet too short!";
+    case OREGON_ERR_NO_SYNC:    return "Start of Oregon sync nibble not found!";
+    case OREGON_ERR_SYMBOL:     return "Oregon packet bit error!";
+    case OREGON_ERR_PKTLEN:     return "Oregon packet too short to decode!";
+    case OREGON_ERR_ID:         return "Oregon ID 0xEC40 not found!";
+    case OREGON_ERR_CHECKSUM:   return "Oregon checksum error!";
+    }
+    return "Unknown error!";
+}
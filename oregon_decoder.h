@@ -0,0 +1,135 @@
+/*
+ * oregon_decoder.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  Hardware independent Oregon v2.1 (THN122N/THN132N) decoding - from the raw
+ *  cc1101 FIFO bytes to a reading. No I/O, no globals written and no allocation:
+ *  inputs are const and all results go to the caller's structures, so it can be
+ *  used from any thread, for captured traffic or in tests. CC1101_Oregon wraps it.
+ */
+
+#ifndef OREGON_DECODER_H_
+#define OREGON_DECODER_H_
+
+#include <stdint.h>
+
+#define OREGON_RAW_MAX			0x42	// FIFO + RSSI and LQI (FIFOBUFFER)
+#define OREGON_FRAME_MAX		(OREGON_RAW_MAX / 4)
+#define OREGON_MIN_RAW_LEN		30		// FIFO bytes (without RSSI and LQI) to look for a frame in
+#define OREGON_RSSI_OFFSET		0x4E	// dec = 74, as RSSI_OFFSET_868MHZ
+
+// ------- definition of starting nibbles in THN122N/THN132N sensors -----------
+
+#define THN122N_ID_SNIBBLE 0
+#define THN122N_CHANNEL_NIBBLE 4
+#define THN122N_RCODE_SNIBBLE 5
+#define THN122N_FLAGS_NIBBLE 7
+#define THN122N_TEMPC_SNIBBLE 8
+#define THN122N_CKSUM_SNIBBLE 12
+#define THN122N_POSTAMBLE_SNIBBLE 14
+
+// ------- end definition of starting nibbles in THN122N/THN132N sensors -------
+
+// ------- fine tuning of probe packets sync and decoding -------
+
+#define THN122N_MIN_PKTLEN_FOR_DECODE 8
+// what is used currently as data after decoding
+#define THN122N_PKTLEN_USED_DECODE (THN122N_MIN_PKTLEN_FOR_DECODE-1)
+
+#define THN122N_CHECK_CC_IN_BUF	0
+
+// ------- end fine tuning of probe packets sync and decoding -------
+
+#if THN122N_CHECK_CC_IN_BUF
+#define THN122N_START_SEARCH_AT	2
+#else
+#define THN122N_START_SEARCH_AT	0
+#endif
+
+// sync_offset values besides the bit offsets 0..7
+#define OREGON_SYNC_NOT_FOUND	8
+#define OREGON_SYNC_NO_SEARCH	0xff
+
+// a reading, 12 bytes - also the record of the per-sensor history; the temperature is
+// fixed point, so nothing on the radio path uses floating point
+typedef struct {
+	uint32_t time;			// seconds since epoch, set by the receiver (0 from the decoder)
+	uint16_t sensor_id;
+	int16_t  temp_dc;		// temperature [0.1 degC]
+	uint8_t  roll_code;
+	uint8_t  channel  : 4;
+	uint8_t  batt_low : 1;
+	uint8_t  cksum_ok : 1;
+	int8_t  rssi_dbm; // the higher the better
+	uint8_t  lqi;     // the lower the better
+} oregon_data_t;
+
+static_assert(sizeof(oregon_data_t) == 12, "oregon_data_t layout");
+
+#define OREGON_TEMP_C(dc)	((dc) / 10.0)	// for display only
+
+// a burst as read from the FIFO, kept for combining when decoding fails
+typedef struct {
+	uint8_t data[OREGON_RAW_MAX];	// without RSSI and LQI
+	uint8_t len;				// 0 - nothing read
+	uint8_t rssi_raw, lqi_raw;
+	uint8_t sync_pos, sync_offset;
+} oregon_raw_t;
+
+typedef enum {
+	OREGON_OK = 0,
+	OREGON_ERR_SHORT,		// too few FIFO bytes
+	OREGON_ERR_NO_SYNC,		// preamble to sync transition not found
+	OREGON_ERR_SYMBOL,		// invalid symbol after the sync - bit error
+	OREGON_ERR_PKTLEN,		// decoded frame too short
+	OREGON_ERR_ID,			// not a THN122N/THN132N
+	OREGON_ERR_CHECKSUM,	// reading decoded, but the checksum is wrong
+} oregon_err_t;
+
+typedef struct {
+	uint8_t data[OREGON_FRAME_MAX];	// decoded bytes, first nibble in the high half
+	uint8_t len;
+	uint8_t sync_pos, sync_offset, sync_score;
+	uint8_t conflicts;				// nibbles the two bursts disagreed on (oregon_combine_raw)
+	oregon_data_t reading;
+} oregon_frame_t;
+
+int8_t oregon_rssi_dbm(uint8_t rssi_raw);
+uint8_t oregon_lqi(uint8_t lqi_raw);
+
+// everything from FIFO bytes to reading: sync search, symbol check and decode, THN122N fields.
+// frame->data/len are valid from OREGON_ERR_PKTLEN on, frame->reading from OREGON_ERR_CHECKSUM on
+oregon_err_t oregon_decode_frame(const uint8_t *fifo, uint8_t len, uint8_t rssi_raw, uint8_t lqi_raw, oregon_frame_t *frame);
+// symbols of fifo[0..len) starting at the sync nibble at pos/offset_bits -> outlen bytes in out
+// (out may be fifo itself)
+oregon_err_t oregon_decode_symbols(const uint8_t *fifo, uint8_t len, uint8_t pos, uint8_t offset_bits, uint8_t *out, uint8_t &outlen);
+// THN122N/THN132N fields of a decoded frame; rssi_dbm and lqi are left alone
+oregon_err_t oregon_parse_thn122n(const uint8_t *data, uint8_t len, oregon_data_t *reading);
+uint8_t oregon_thn122n_checksum_ok(const uint8_t *data);
+// rebuild a frame from two bursts that failed decoding, nibble by nibble - the checksum decides
+oregon_err_t oregon_combine_raw(const oregon_raw_t *raw1, const oregon_raw_t *raw2, oregon_frame_t *frame);
+
+// the two bursts of a message, judged as the daemon counts them
+typedef struct {
+	oregon_frame_t frame1, frame2;	// each burst on its own
+	uint8_t res1, res2;				// burst decoded (sync found, all symbols valid)
+	uint8_t combined;				// rebuilt from two bad bursts
+	uint8_t conflicts;
+	uint8_t buffdiff;				// both decoded, but different
+	uint8_t pktlen;					// of the frame used, 0 if none
+	uint8_t cksum_ok;				// 1 unless a parsed frame had a wrong checksum
+	uint8_t good;					// reading is valid
+	int8_t rssi_dbm1, rssi_dbm2;	// as used for the RSSI/LQI statistics
+	uint8_t lqi1, lqi2;
+	oregon_data_t reading;			// RSSI min / LQI max of the two
+} oregon_message_t;
+
+// need_both - only accept a message if both bursts decoded the same (PARANOID_NEEDS_BOTH_MESSAGES)
+void oregon_decode_message(const oregon_raw_t *raw1, const oregon_raw_t *raw2, int need_both, oregon_message_t *msg);
+// burst result as CC1101_Oregon::get_oregon_raw reports it
+#define OREGON_BURST_OK(err)	((err) != OREGON_ERR_SHORT && (err) != OREGON_ERR_NO_SYNC && (err) != OREGON_ERR_SYMBOL)
+
+const char *oregon_strerror(oregon_err_t err);
+
+#endif /* OREGON_DECODER_H_ */
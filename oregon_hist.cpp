@@ -0,0 +1,78 @@
+/*
+ * oregon_hist.cpp
+ *
+ *  Created on: 17Oct.,2026
+ */
+
+#include "oregon_hist.h"
+#include <string.h>
+
+#define SUB_COUNT	(1 << OREGON_HIST_SUB_BITS)
+#define LINEAR_MAX	(1 << OREGON_HIST_LINEAR_BITS)	// values with a bucket each
+
+static unsigned int bucket_index(uint32_t value)
+{
+	unsigned int e;
+
+	if (value < LINEAR_MAX)
+		return value;
+	if (value >> OREGON_HIST_MAX_BITS)
+		return OREGON_HIST_BUCKETS - 1;
+	e = 31 - __builtin_clz(value);		// >= LINEAR_BITS
+	return LINEAR_MAX + (e - OREGON_HIST_LINEAR_BITS) * SUB_COUNT +
+			((value >> (e - OREGON_HIST_SUB_BITS)) & (SUB_COUNT - 1));
+}
+
+static unsigned int bucket_shift(unsigned int i)
+{
+	if (i < LINEAR_MAX)
+		return 0;
+	return (i - LINEAR_MAX) / SUB_COUNT + OREGON_HIST_LINEAR_BITS - OREGON_HIST_SUB_BITS;
+}
+
+uint32_t oregon_hist_bucket_low(unsigned int i)
+{
+	if (i < LINEAR_MAX)
+		return i;
+	return (SUB_COUNT + (i - LINEAR_MAX) % SUB_COUNT) << bucket_shift(i);
+}
+
+uint32_t oregon_hist_bucket_high(unsigned int i)
+{
+	return oregon_hist_bucket_low(i) + (1 << bucket_shift(i)) - 1;
+}
+
+static uint32_t bucket_value(unsigned int i)
+{
+	return oregon_hist_bucket_low(i) + (1 << bucket_shift(i)) / 2;
+}
+
+void oregon_hist_add(oregon_hist_t *h, uint32_t value)
+{
+	h->count[bucket_index(value)]++;
+	h->total++;
+	h->sum += value;
+}
+
+uint32_t oregon_hist_percentile(const oregon_hist_t *h, unsigned int pct)
+{
+	uint64_t rank, seen = 0;
+	unsigned int i;
+
+	if (!h->total)
+		return 0;
+	rank = ((uint64_t)h->total * pct + 99) / 100;		// samples at or below the result
+	if (!rank)
+		rank = 1;
+	for(i = 0; i < OREGON_HIST_BUCKETS; i++) {
+		seen += h->count[i];
+		if (seen >= rank)
+			return bucket_value(i);
+	}
+	return bucket_value(OREGON_HIST_BUCKETS - 1);
+}
+
+void oregon_hist_clear(oregon_hist_t *h)
+{
+	memset(h, 0, sizeof(*h));
+}
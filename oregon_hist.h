@@ -0,0 +1,38 @@
+/*
+ * oregon_hist.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  Fixed size streaming histogram with log-linear buckets (as HDR histograms):
+ *  values below 2^LINEAR_BITS have a bucket each - so all RSSI (negated) and LQI
+ *  values are exact - above that every power of two is split into 2^SUB_BITS
+ *  buckets, so percentiles are within ~1.6% of the value.
+ *  Adding a value is O(1) and needs no allocation - fits in shared memory.
+ */
+
+#ifndef OREGON_HIST_H_
+#define OREGON_HIST_H_
+
+#include <stdint.h>
+
+#define OREGON_HIST_SUB_BITS	5
+#define OREGON_HIST_LINEAR_BITS	8		// > SUB_BITS, 0..255 - a byte of the radio
+#define OREGON_HIST_MAX_BITS	17		// larger values go to the last bucket
+#define OREGON_HIST_BUCKETS		((1 << OREGON_HIST_LINEAR_BITS) + \
+		(OREGON_HIST_MAX_BITS - OREGON_HIST_LINEAR_BITS) * (1 << OREGON_HIST_SUB_BITS))
+
+typedef struct {
+	uint64_t sum;							// of the values added
+	uint32_t total;
+	uint32_t count[OREGON_HIST_BUCKETS];
+} oregon_hist_t;
+
+void oregon_hist_add(oregon_hist_t *h, uint32_t value);
+// value at pct percent (0..100) of the samples, middle of its bucket; 0 if empty
+uint32_t oregon_hist_percentile(const oregon_hist_t *h, unsigned int pct);
+void oregon_hist_clear(oregon_hist_t *h);
+// range of the values counted in bucket i (the last one also counts all larger values)
+uint32_t oregon_hist_bucket_low(unsigned int i);
+uint32_t oregon_hist_bucket_high(unsigned int i);
+
+#endif /* OREGON_HIST_H_ */
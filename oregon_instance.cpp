@@ -0,0 +1,442 @@
+/*
+ * oregon_instance.cpp
+ *
+ *  Created on: 17Oct.,2026
+ */
+
+#include "oregon_instance.h"
+#include "oregon_log.h"
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <limits.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define SHM_READ_SPINS		100	// seqlock reader retries before yielding the CPU
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+#define ABS(a) ( (a) < 0 ? (-(a)) : (a) )
+
+struct INSTANCE *my_instance = NULL;
+static char    strbuf[LINELEN];
+
+static void    add_rx_hists(struct RX_HISTS *h, oregon_message_t *msg, unsigned int latency_us);
+
+void update_global_stats(struct INSTANCE *is, oregon_message_t *msg, unsigned int latency_us)
+{
+	  is->rssi_sum += (msg->rssi_dbm1 + msg->rssi_dbm2)/2;
+	  is->lqi_sum += (msg->lqi1 + msg->lqi2)/2;
+	  add_rx_hists(&is->hists, msg, latency_us);
+	  is->rssi_min = MIN(MIN(msg->rssi_dbm1, msg->rssi_dbm2), is->rssi_min);
+	  is->rssi_max = MAX(MAX(msg->rssi_dbm1, msg->rssi_dbm2), is->rssi_max);
+	  is->lqi_max = MAX(MAX(msg->lqi1, msg->lqi2), is->lqi_max);
+	  is->lqi_min = MIN(MIN(msg->lqi1, msg->lqi2), is->lqi_min);
+}
+
+static void add_rx_hists(struct RX_HISTS *h, oregon_message_t *msg, unsigned int latency_us)
+{
+	int rssi = (msg->rssi_dbm1 + msg->rssi_dbm2)/2;
+
+	oregon_hist_add(&h->rssi, (rssi < 0) ? -rssi : 0);
+	oregon_hist_add(&h->lqi, (msg->lqi1 + msg->lqi2)/2);
+	oregon_hist_add(&h->latency, latency_us);
+}
+
+void update_sync_stats(struct INSTANCE *is, uint8_t sync_offset)
+{
+	if (sync_offset != OREGON_SYNC_NO_SEARCH)
+		is->sync_hits[sync_offset]++;
+}
+
+void update_service_stats(struct INSTANCE *is, unsigned int service_us)
+{
+	oregon_hist_add(&is->service, service_us);
+	is->service_max_us = MAX(is->service_max_us, service_us);
+}
+
+//-----------------------[shared memory seqlock]--------------------------------
+void shm_write_begin(struct INSTANCE *is)
+{
+	__atomic_store_n(&is->seq, is->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);	// odd seq visible before any data store
+}
+
+void shm_write_end(struct INSTANCE *is)
+{
+	__atomic_store_n(&is->seq, is->seq + 1, __ATOMIC_RELEASE);
+}
+
+void shm_snapshot(struct INSTANCE *is, struct INSTANCE *snap, int with_hists)
+{
+	uint32_t seq1, seq2;
+	int tries = 0;
+
+	do {
+		if (++tries > SHM_READ_SPINS)
+			sched_yield();		// the daemon may have been preempted mid-update
+		seq1 = __atomic_load_n(&is->seq, __ATOMIC_ACQUIRE);
+		if (seq1 & 1)
+			continue;
+		memcpy(snap, is, with_hists ? offsetof(struct INSTANCE, history) : offsetof(struct INSTANCE, hists));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);	// data loads done before seq is checked again
+		seq2 = __atomic_load_n(&is->seq, __ATOMIC_RELAXED);
+	} while ((seq1 & 1) || seq1 != seq2);
+}
+//-------------------------------[end]------------------------------------------
+
+static unsigned int sensor_hash(uint16_t id, uint8_t chan, uint8_t roll)
+{
+	uint32_t key = ((uint32_t)id << 16) | ((uint32_t)chan << 8) | roll;
+
+	return (key * 0x9E3779B1u) >> (32 - OREGON_SENSOR_BITS);
+}
+
+void update_sensor(struct INSTANCE *is, oregon_message_t *msg, unsigned int rx_ms, unsigned int latency_us)
+{
+	oregon_data_t *od = &msg->reading;
+	struct SENSOR *s = NULL, *oldest = NULL;
+	struct HISTORY *hist;
+	struct RX_HISTS *hists;
+	unsigned int i, h, uDiffTime, intvl;
+
+	h = sensor_hash(od->sensor_id, od->channel, od->roll_code);
+	for(i = 0; i < OREGON_MAX_SENSORS; i++) {
+		s = &is->sensors[(h + i) & (OREGON_MAX_SENSORS - 1)];
+		if (!s->used || (s->oregon_data.sensor_id == od->sensor_id &&
+				s->oregon_data.channel == od->channel && s->oregon_data.roll_code == od->roll_code))
+			break;
+		if (!oldest || s->oregon_data.time < oldest->oregon_data.time)
+			oldest = s;
+	}
+	if (i == OREGON_MAX_SENSORS) {
+		// table full - the slot stays occupied, so no probe chain is broken
+		s = oldest;
+		Log(LOG_EVICTED, s->oregon_data.sensor_id, s->oregon_data.channel, s->oregon_data.roll_code, s->good_reads);
+		s->used = 0;
+		is->sensor_evictions++;
+	} else if (!s->used)
+		is->sensor_count++;
+	hist = &is->history[s - is->sensors];
+	hists = &is->sensor_hists[s - is->sensors];
+	if (!s->used) {
+		memset(s, 0, sizeof(*s));
+		init_sensor_stats(s, hists, 0xff);
+		s->hist_base = hist->head;
+		s->used = 1;
+	}
+	s->good_reads++;
+	if (msg->combined)
+		s->combined_reads++;
+	if (s->good_reads > 1) {
+		if (rx_ms < s->last_rx_ms)
+			uDiffTime = rx_ms + ~s->last_rx_ms + 1;
+		else
+			uDiffTime = rx_ms - s->last_rx_ms;
+		intvl = uDiffTime/1000 + (uDiffTime % 1000)/500;
+		s->min_intvl = MIN(s->min_intvl, intvl);
+		s->max_intvl = MAX(s->max_intvl, intvl);
+		s->max_temp_diff = MAX(ABS(od->temp_dc - s->oregon_data.temp_dc), s->max_temp_diff);
+		oregon_hist_add(&hists->intvl, intvl);
+		// the receiver's interval stats are over all sensors' own intervals - between
+		// packets of different sensors they would say nothing
+		is->min_intvl = MIN(is->min_intvl, intvl);
+		is->max_intvl = MAX(is->max_intvl, intvl);
+		is->max_temp_diff = MAX(ABS(od->temp_dc - s->oregon_data.temp_dc), is->max_temp_diff);
+		oregon_hist_add(&is->hists.intvl, intvl);
+	}
+	s->rssi_sum += (msg->rssi_dbm1 + msg->rssi_dbm2)/2;
+	s->lqi_sum += (msg->lqi1 + msg->lqi2)/2;
+	add_rx_hists(hists, msg, latency_us);
+	s->rssi_min = MIN(MIN(msg->rssi_dbm1, msg->rssi_dbm2), s->rssi_min);
+	s->rssi_max = MAX(MAX(msg->rssi_dbm1, msg->rssi_dbm2), s->rssi_max);
+	s->lqi_max = MAX(MAX(msg->lqi1, msg->lqi2), s->lqi_max);
+	s->lqi_min = MIN(MIN(msg->lqi1, msg->lqi2), s->lqi_min);
+	s->oregon_data = *od;
+	s->last_rx_ms = rx_ms;
+	hist->r[hist->head % OREGON_HISTORY_LEN] = *od;
+	__atomic_store_n(&hist->head, hist->head + 1, __ATOMIC_RELEASE);
+}
+
+// readings of a sensor slot, oldest first; the last ones (0 - all) since a time, and with
+// pos from *pos on (*pos is then moved past them). A reading the daemon may have overwritten
+// while it was copied is dropped, and all of them if the slot went to another sensor meanwhile.
+int read_history(struct INSTANCE *is, struct INSTANCE *snap, int slot, oregon_data_t *out, long last, time_t since, unsigned long *pos)
+{
+	struct HISTORY *hist = &is->history[slot];
+	unsigned long base = snap->sensors[slot].hist_base;
+	unsigned long head, from, valid, i;
+	int n = 0;
+
+	head = __atomic_load_n(&hist->head, __ATOMIC_ACQUIRE);
+	from = (head > OREGON_HISTORY_LEN) ? head - OREGON_HISTORY_LEN : 0;
+	if (last > 0 && head - from > (unsigned long)last)
+		from = head - last;
+	from = MAX(from, base);
+	if (pos) {
+		from = MAX(from, *pos);
+		*pos = MAX(head, *pos);
+	}
+	for(i = from; i < head; i++)
+		out[i - from] = hist->r[i % OREGON_HISTORY_LEN];
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	valid = __atomic_load_n(&hist->head, __ATOMIC_RELAXED);
+	valid = (valid >= OREGON_HISTORY_LEN) ? valid - OREGON_HISTORY_LEN + 1 : 0;
+	if (__atomic_load_n(&is->sensors[slot].hist_base, __ATOMIC_RELAXED) != base)
+		return 0;
+	for(i = MAX(from, valid); i < head; i++)
+		if (out[i - from].time >= since)
+			out[n++] = out[i - from];
+	return n;
+}
+
+// called after a good reading is published - wakes the followers, a syscall per reading
+void notify_readings(struct INSTANCE *is)
+{
+	__atomic_add_fetch(&is->readings, 1, __ATOMIC_RELEASE);
+	syscall(SYS_futex, &is->readings, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// readers scan the whole table, so any of the keys can be left out (-1)
+int sensor_match(struct SENSOR *s, long id, long chan, long roll)
+{
+	return s->used && (id < 0 || s->oregon_data.sensor_id == id) &&
+			(chan < 0 || s->oregon_data.channel == chan) &&
+			(roll < 0 || s->oregon_data.roll_code == roll);
+}
+
+// with several matches (e.g. old roll codes) the latest updated one wins
+struct SENSOR *find_sensor(struct INSTANCE *is, long id, long chan, long roll)
+{
+	struct SENSOR *s, *found = NULL;
+	int i;
+
+	for(i = 0; i < OREGON_MAX_SENSORS; i++) {
+		s = &is->sensors[i];
+		if (!sensor_match(s, id, chan, roll))
+			continue;
+		if (!found || s->oregon_data.time > found->oregon_data.time)
+			found = s;
+	}
+	return found;
+}
+
+void init_inst_struct(struct INSTANCE *is, int clear_all)
+{
+	int i;
+
+	if (clear_all)
+		memset((char *) is, 0, sizeof(*is));
+	else {
+		for(i = 0; i < OREGON_MAX_SENSORS; i++)
+			if (is->sensors[i].used)
+				init_sensor_stats(&is->sensors[i], &is->sensor_hists[i], is->reset_flags);
+		if (is->reset_flags == 0xff) {
+			is->total_reads = 0;
+			is->rssi_sum = 0;
+			is->lqi_sum = 0;
+		}
+		if (is->reset_flags & 0x1) {
+			is->good_reads = is->total_reads;
+			is->brst1_errors = 0;
+			is->brst2_errors = 0;
+			is->mbrst_errors = 0;
+			is->pktlen_errors = 0;
+			is->buffmatch_errors = 0;
+			is->chksum_errors = 0;
+			memset(is->sync_hits, 0, sizeof(is->sync_hits));
+			is->combined_reads = 0;
+			is->rx_dropped = 0;
+			is->service_max_us = 0;
+			memset(is->radio_ms, 0, sizeof(is->radio_ms));
+			memset(is->radio_msgs, 0, sizeof(is->radio_msgs));
+			is->radio_wakeups = 0;
+			oregon_hist_clear(&is->service);
+			oregon_hist_clear(&is->hists.rssi);
+			oregon_hist_clear(&is->hists.lqi);
+			oregon_hist_clear(&is->hists.latency);
+			is->reset_flags |= 0x4 | 0x8;
+		}
+		if (is->reset_flags & 0x2) {
+			is->max_intvl = 0;
+			oregon_hist_clear(&is->hists.intvl);
+		}
+		if (is->reset_flags & 0x8)
+			is->lqi_max = 0;
+		if (is->reset_flags & 0x10)
+			is->max_temp_diff = 0;
+	}
+	if ((is->reset_flags & 0x2) || clear_all)
+		is->min_intvl = 0xffff;
+	if ((is->reset_flags & 0x8) || clear_all)
+		is->lqi_min = 127;
+	if ((is->reset_flags & 0x4) || clear_all) {
+		is->rssi_max = -128;
+		is->rssi_min = 127;
+	}
+	is->reset_flags = 0xff;
+}
+
+// the -r flags as for the whole receiver, except that there are no error counters
+void init_sensor_stats(struct SENSOR *s, struct RX_HISTS *h, long flags)
+{
+	if (flags == 0xff) {
+		s->good_reads = 0;
+		s->rssi_sum = 0;
+		s->lqi_sum = 0;
+	}
+	if (flags & 0x1) {
+		s->combined_reads = 0;
+		oregon_hist_clear(&h->rssi);
+		oregon_hist_clear(&h->lqi);
+		oregon_hist_clear(&h->latency);
+		flags |= 0x4 | 0x8;
+	}
+	if (flags & 0x2) {
+		s->max_intvl = 0;
+		oregon_hist_clear(&h->intvl);
+		s->min_intvl = 0xffff;
+	}
+	if (flags & 0x4) {
+		s->rssi_max = -128;
+		s->rssi_min = 127;
+	}
+	if (flags & 0x8) {
+		s->lqi_max = 0;
+		s->lqi_min = 127;
+	}
+	if (flags & 0x10)
+		s->max_temp_diff = 0;
+}
+
+void disp_rx_stats(struct INSTANCE *is)
+{
+	uint64_t radio_ms;
+	double wor_duty;
+
+	Msg("Bad/Total received Oregon packets:           %lu / %lu", is->total_reads - is->good_reads, is->total_reads);
+//	if (is->good_reads < is->total_reads)
+	Msg("Errors: brst1 / brst2 / mburst:              %u / %u / %u", is->brst1_errors, is->brst2_errors, is->mbrst_errors);
+	Msg("Errors: pktlen / bfmatch / chksum:           %u / %u / %u", is->pktlen_errors, is->buffmatch_errors, is->chksum_errors);
+	Msg("Good packets rebuilt from 2 bad bursts:       %lu", is->combined_reads);
+	if (is->rx_dropped)
+		Msg("Bursts dropped, decoding too far behind:      %lu", is->rx_dropped);
+	Msg("Sync @ bit offset 0..7 / not found:          %lu %lu %lu %lu %lu %lu %lu %lu / %lu",
+			is->sync_hits[0], is->sync_hits[1], is->sync_hits[2], is->sync_hits[3], is->sync_hits[4],
+			is->sync_hits[5], is->sync_hits[6], is->sync_hits[7], is->sync_hits[OREGON_SYNC_NOT_FOUND]);
+	if (is->min_intvl <= is->max_intvl) {
+		Msg("Min/Max time between good packets [s]:       %u / %u", is->min_intvl, is->max_intvl);
+		Msg("Max T variation between updates [degC]:      %.1f", OREGON_TEMP_C(is->max_temp_diff));
+	}
+	if (is->good_reads > 0) {
+		if (is->rssi_max >= is->rssi_min)
+			Msg("Min/Average/Max RSSI (good packets) [dBm]:  %d / %ld / %d", is->rssi_min, (long)(is->rssi_sum / (int64_t)is->good_reads), is->rssi_max);
+		if (is->lqi_max >= is->lqi_min)
+			Msg("Max/Average/Min LQI (good packets):          %u / %lu / %u", is->lqi_max, (unsigned long)(is->lqi_sum / is->good_reads), is->lqi_min);
+	}
+	disp_rx_hists(&is->hists);
+	if (is->service.total) {
+		disp_percentiles("Radio service [us]", &is->service, 0);
+		Msg("Worst radio service latency [us]:            %u", is->service_max_us);
+	}
+	radio_ms = is->radio_ms[RADIO_RX] + is->radio_ms[RADIO_WOR] + is->radio_ms[RADIO_SLEEP];
+	if (radio_ms) {
+		Msg("Radio listening / on WOR / powered down [%%]: %.1f / %.1f / %.1f",
+				100.0 * is->radio_ms[RADIO_RX] / radio_ms, 100.0 * is->radio_ms[RADIO_WOR] / radio_ms,
+				100.0 * is->radio_ms[RADIO_SLEEP] / radio_ms);
+		Msg("Radio loop wakeups [per min]:                %.1f", is->radio_wakeups * 60000.0 / radio_ms);
+	}
+	// on WOR the radio listens wor_listen_us of every wor_event0_us, plus the packets caught
+	if (is->radio_ms[RADIO_WOR] && is->wor_event0_us) {
+		wor_duty = (double)is->wor_listen_us / is->wor_event0_us;
+		Msg("WOR wake-up period [ms] / listening [%%]:     %.1f / %.1f", is->wor_event0_us / 1000.0, 100.0 * wor_duty);
+		Msg("Radio RX duty cycle between packets [%%]:     %.1f",
+				100.0 * (is->radio_ms[RADIO_RX] + wor_duty * is->radio_ms[RADIO_WOR]) / radio_ms);
+	}
+	// -w alone: continuous RX while learning, the reference for the yield of WOR
+	if (is->radio_ms[RADIO_RX] && is->radio_ms[RADIO_WOR] && !is->radio_ms[RADIO_SLEEP] && is->radio_msgs[RADIO_RX]) {
+		Msg("Messages per hour listening / on WOR:        %.1f / %.1f",
+				is->radio_msgs[RADIO_RX] * 3600000.0 / is->radio_ms[RADIO_RX],
+				is->radio_msgs[RADIO_WOR] * 3600000.0 / is->radio_ms[RADIO_WOR]);
+		Msg("WOR message yield vs continuous RX [%%]:      %.1f", 100.0 * is->radio_msgs[RADIO_WOR] * is->radio_ms[RADIO_RX] /
+				((double)is->radio_msgs[RADIO_RX] * is->radio_ms[RADIO_WOR]));
+	}
+}
+
+void disp_rx_hists(struct RX_HISTS *h)
+{
+	disp_percentiles("RSSI (weakest) [dBm]", &h->rssi, 1);
+	disp_percentiles("LQI", &h->lqi, 0);
+	disp_percentiles("Time between good pkts [s]", &h->intvl, 0);
+	disp_percentiles("Rx to publish latency [us]", &h->latency, 0);
+}
+
+void disp_percentiles(const char *what, oregon_hist_t *h, int negate)
+{
+	int sign = negate ? -1 : 1;
+
+	if (!h->total)
+		return;
+	Msg("%-26s p50/p90/p99:     %d / %d / %d", what, sign * (int)oregon_hist_percentile(h, 50),
+			sign * (int)oregon_hist_percentile(h, 90), sign * (int)oregon_hist_percentile(h, 99));
+}
+
+void disp_oregon_data(oregon_data_t *od, time_t upd_time, int disp_time)
+{
+	if (disp_time)
+		Msg("Time received: %s (%d sec. ago)", nol_ctime(&upd_time), time(NULL)-upd_time);
+	Msg("RSSI min [dBm]: %d  LQI max: %d", od->rssi_dbm, od->lqi);
+	Msg("sensor ID: 0x%04X", od->sensor_id);
+	Msg("sensor chan: %d", od->channel);
+	Msg("roll code: 0x%02X", od->roll_code);
+	Msg("batt_low: %d", od->batt_low);
+	Msg("cksum_ok: %d", od->cksum_ok);
+//	Msg("Time received: %s", ctime(&upd_time));
+	Msg("temperature [degC]: %.1f", OREGON_TEMP_C(od->temp_dc));
+
+}
+
+void disp_sensor(struct SENSOR *s, struct RX_HISTS *h, int disp_time)
+{
+	Msg("=== Sensor 0x%04X ch %d roll 0x%02X ===", s->oregon_data.sensor_id, s->oregon_data.channel, s->oregon_data.roll_code);
+	if (disp_time)
+		disp_oregon_data(&s->oregon_data, s->oregon_data.time, disp_time);
+	Msg("Good packets / rebuilt from 2 bad bursts:    %lu / %lu", s->good_reads, s->combined_reads);
+	if (s->good_reads > 1) {
+		Msg("Min/Max time between good packets [s]:       %u / %u", s->min_intvl, s->max_intvl);
+		Msg("Max T variation between updates [degC]:      %.1f", OREGON_TEMP_C(s->max_temp_diff));
+	}
+	if (s->good_reads > 0) {
+		if (s->rssi_max >= s->rssi_min)
+			Msg("Min/Average/Max RSSI (good packets) [dBm]:  %d / %ld / %d", s->rssi_min, (long)(s->rssi_sum / (int64_t)s->good_reads), s->rssi_max);
+		if (s->lqi_max >= s->lqi_min)
+			Msg("Max/Average/Min LQI (good packets):          %u / %lu / %u", s->lqi_max, (unsigned long)(s->lqi_sum / s->good_reads), s->lqi_min);
+	}
+	disp_rx_hists(h);
+}
+
+void disp_sensors(struct INSTANCE *is)
+{
+	int i;
+
+	Msg("Sensors heard / table slots / replaced:      %u / %d / %lu", is->sensor_count, OREGON_MAX_SENSORS, is->sensor_evictions);
+	for(i = 0; i < OREGON_MAX_SENSORS; i++)
+		if (is->sensors[i].used)
+			disp_sensor(&is->sensors[i], &is->sensor_hists[i], 0);
+}
+
+void disp_reading(oregon_data_t *r)
+{
+	printf("%lu,0x%04X,%u,0x%02X,%u,%.1f,%d,%u\n", (unsigned long)r->time, r->sensor_id,
+			r->channel, r->roll_code, r->batt_low, OREGON_TEMP_C(r->temp_dc), r->rssi_dbm, r->lqi);
+}
+
+char   *nol_ctime(const time_t *timep)
+{
+	struct tm *ptm = localtime(timep);
+	strftime(strbuf, LINELEN, "%c", ptm);
+	return strbuf;
+}
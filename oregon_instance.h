@@ -0,0 +1,130 @@
+/*
+ * oregon_instance.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  State of the 'oregon_read' daemon, in SysV shared memory or a mapped state
+ *  file (-P): the receiver and per sensor statistics, the latest readings and
+ *  their history. The publish thread is its only writer; readers (clients, the
+ *  query server) never stop it - they take seqlock snapshots.
+ */
+
+#ifndef OREGON_INSTANCE_H_
+#define OREGON_INSTANCE_H_
+
+#include "oregon_decoder.h"
+#include "oregon_hist.h"
+#include <stdint.h>
+#include <time.h>
+
+#define OREGON_STATE_DIR	"/var/lib/oregon_read"
+#define OREGON_STATE_FILE	OREGON_STATE_DIR "/state"
+#define STATE_VERSION		11	// bump on any change of struct INSTANCE
+#define OREGON_SENSOR_BITS	7		// the simulator's SIM_MAX_SENSORS fill half of the table
+#define OREGON_MAX_SENSORS	(1 << OREGON_SENSOR_BITS)	// sensor table slots
+#define OREGON_HISTORY_LEN	2048	// readings kept per sensor (~22 h for a THN122N)
+
+// one sensor, keyed by ID, channel and roll code (a new roll code after a battery change
+// is a new sensor), with the statistics of its good packets
+struct SENSOR {
+	uint8_t	used;
+	oregon_data_t oregon_data; // .time - last update
+	unsigned int last_rx_ms; // transport time (ms) of the last good packet
+	unsigned long good_reads;
+	unsigned long combined_reads;
+	unsigned int  min_intvl, max_intvl;
+	int	max_temp_diff; // [0.1 degC]
+	int64_t	rssi_sum;
+	uint64_t	lqi_sum;
+	uint8_t lqi_max, lqi_min;
+	int8_t rssi_max, rssi_min;
+	unsigned long hist_base; // history head when the sensor got this slot
+};
+
+// single writer ring: the reading is stored first, then head (count of readings ever
+// written to this slot) is advanced - readers need no lock, see read_history()
+struct HISTORY {
+	unsigned long head;
+	oregon_data_t r[OREGON_HISTORY_LEN];
+};
+
+// good packet distributions - RSSI is negated, so that as for the others the high
+// percentiles are the bad tail
+struct RX_HISTS {
+	oregon_hist_t rssi;		// -dBm
+	oregon_hist_t lqi;
+	oregon_hist_t intvl;	// s between good packets
+	oregon_hist_t latency;	// us from the end of the packet to its publication
+};
+static_assert(sizeof(struct RX_HISTS) == 4 * sizeof(oregon_hist_t), "RX_HISTS is indexed as an array");
+
+// what the radio does between bursts
+enum { RADIO_RX, RADIO_WOR, RADIO_SLEEP, RADIO_MODES };
+
+struct INSTANCE {
+	int	pid;
+	// seqlock: odd while the daemon updates the fields below, readers take a snapshot
+	// with shm_snapshot() and retry if it changed meanwhile - the daemon never waits
+	uint32_t seq;
+	// good readings published so far - a futex word, followers (-F) wait on it
+	uint32_t readings;
+	int data_invalid_timeout;
+	oregon_data_t oregon_data;
+	time_t	last_upd_time; // last time data has been received from oregon sensor
+	// statistics
+	unsigned long total_reads;
+	unsigned long good_reads;
+	unsigned int  min_intvl, max_intvl;
+	unsigned int brst1_errors, brst2_errors, mbrst_errors, pktlen_errors, buffmatch_errors, chksum_errors;
+	unsigned long sync_hits[OREGON_SYNC_NOT_FOUND+1]; // per sync bit offset, last one - not found
+	unsigned long combined_reads; // good packets rebuilt from two bad bursts
+	unsigned long rx_dropped; // bursts the radio thread could not hand over - decoding too far behind
+	unsigned int service_max_us; // worst radio service latency - end of packet to FIFO read
+	uint64_t radio_ms[RADIO_MODES]; // time the radio spent listening, on WOR and powered down (-s, -w)
+	uint64_t radio_msgs[RADIO_MODES]; // messages first heard in each of them
+	uint64_t radio_wakeups; // of the radio loop - waits and sleeps that ended
+	unsigned int wor_event0_us, wor_listen_us; // WOR as last programmed (-w)
+	int	max_temp_diff; // [0.1 degC]
+	int64_t	rssi_sum;
+	uint64_t	lqi_sum;
+	uint8_t lqi_max, lqi_min;
+	int8_t rssi_max, rssi_min;
+	long	reset_flags;
+	// open addressed (linear probing) table of the sensors heard, the least recently
+	// updated one is replaced when it is full
+	unsigned int sensor_count;
+	unsigned long sensor_evictions;
+	struct SENSOR sensors[OREGON_MAX_SENSORS];
+	// large - in a reader snapshot only when asked for (-V)
+	struct RX_HISTS hists;
+	oregon_hist_t service;	// us from the end of a packet to its FIFO read - every burst
+	struct RX_HISTS sensor_hists[OREGON_MAX_SENSORS];
+	// per sensor slot, last as it is not part of the seqlock snapshot
+	struct HISTORY history[OREGON_MAX_SENSORS];
+};
+
+extern struct INSTANCE *my_instance;	// of the daemon
+
+void    shm_write_begin(struct INSTANCE *is);
+void    shm_write_end(struct INSTANCE *is);
+void    shm_snapshot(struct INSTANCE *is, struct INSTANCE *snap, int with_hists);
+void    update_global_stats(struct INSTANCE *is, oregon_message_t *msg, unsigned int latency_us);
+void    update_sync_stats(struct INSTANCE *is, uint8_t sync_offset);
+void    update_service_stats(struct INSTANCE *is, unsigned int service_us);
+void    update_sensor(struct INSTANCE *is, oregon_message_t *msg, unsigned int rx_ms, unsigned int latency_us);
+void    notify_readings(struct INSTANCE *is);
+int     sensor_match(struct SENSOR *s, long id, long chan, long roll);
+struct SENSOR *find_sensor(struct INSTANCE *is, long id, long chan, long roll);
+int     read_history(struct INSTANCE *is, struct INSTANCE *snap, int slot, oregon_data_t *out, long last, time_t since, unsigned long *pos);
+void    init_inst_struct(struct INSTANCE *is, int clear_all);
+void    init_sensor_stats(struct SENSOR *s, struct RX_HISTS *h, long flags);
+void    disp_rx_stats(struct INSTANCE *is);
+void    disp_rx_hists(struct RX_HISTS *h);
+void    disp_percentiles(const char *what, oregon_hist_t *h, int negate);
+void	disp_oregon_data(oregon_data_t *od, time_t upd_time, int disp_time);
+void    disp_sensor(struct SENSOR *s, struct RX_HISTS *h, int disp_time);
+void    disp_sensors(struct INSTANCE *is);
+void    disp_reading(oregon_data_t *r);
+char   *nol_ctime(const time_t *timep);
+
+#endif /* OREGON_INSTANCE_H_ */
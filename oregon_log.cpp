@@ -0,0 +1,243 @@
+/*
+ * oregon_log.cpp
+ *
+ *  Created on: 17Oct.,2026
+ */
+
+#include "oregon_log.h"
+#include "oregon_ring.h"
+#include "oregon_decoder.h"
+#include "oregon_pipeline.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <pthread.h>
+
+#define LOG_RING_LEN		512		// log records between the publish and the log thread
+#define LOG_MAX_ARGS		8
+#define LOG_TEXT_LEN		(LINELEN - 8)	// a Msg() line of the publish thread
+
+// Arguments are long, the formats have no length modifiers; %D is a value in tenths
+// (temp_dc) shown as %.1f. per_s - at most that many per second, 0 - no limit.
+static const struct LOG_FMT {
+	const char *fmt;
+	int	per_s;
+} log_fmts[LOG_IDS] = {
+	{ "%s", 100 },	// formatted by Msg()
+	{ "Rx @ %d.%d s:", 0 },
+	{ "res1 %d  res2 %d  pktlen1 %u  pktlen2 %u", 20 },
+	{ "Oregon frame rebuilt from both bursts (%d conflicts)", 20 },
+	{ "Oregon pkt (bad/all) # %u / %u ", 0 },
+	{ "RSSI min [dBm]: %d  LQI max: %d\nsensor ID: 0x%04X\nsensor chan: %d\nroll code: 0x%02X\n"
+	  "batt_low: %d\ncksum_ok: %d\ntemperature [degC]: %D", 0 },
+	{ "", 0 },
+	{ "Oregon Rx statistics was reset!", 0 },
+	{ "Sensor table full - 0x%04X ch %d roll 0x%02X (%u good packets) replaced", 20 },
+};
+
+struct LOG_REC {
+	int	id;		// LOG_*
+	union {
+		long	a[LOG_MAX_ARGS];
+		char	text[LOG_TEXT_LEN];	// LOG_TEXT
+	};
+};
+
+static oregon_ring_t log_ring;
+static struct LOG_REC log_recs[LOG_RING_LEN];
+static pthread_t log_thread;
+static int	log_wait		=	0;
+static uint32_t log_dropped	=	0;	// records the ring had no room for
+int	log2syslog		= 	0;
+int	log_running		=	0;
+__thread int log_producer	=	0;
+
+static struct LOG_REC *log_claim();
+static void   *log_writer(void *arg);
+static void    log_emit(struct LOG_REC *rec);
+static void    log_format(char *buf, size_t size, const char *fmt, const long *a);
+
+void log_begin(int wait)
+{
+	log_wait = wait;
+	oregon_ring_init(&log_ring, log_recs, sizeof(log_recs[0]), LOG_RING_LEN);
+	if (!(log_running = start_thread(&log_thread, log_writer)))
+		Msg("Cannot start the log thread - logging directly.");
+}
+
+// the queued records are still written
+void log_end()
+{
+	if (!log_running)
+		return;
+	oregon_ring_close(&log_ring);
+	pthread_join(log_thread, NULL);
+	log_running = 0;
+}
+
+// a slot for a record, NULL if the log thread is that far behind - the record is dropped
+// then (counted), unless log_begin() was told to wait.
+static struct LOG_REC *log_claim()
+{
+	struct LOG_REC *rec;
+
+	while ((rec = (struct LOG_REC *)oregon_ring_claim(&log_ring)) == NULL && log_wait)
+		oregon_ring_wait_space(&log_ring, -1);
+	if (!rec)
+		__atomic_store_n(&log_dropped, log_dropped + 1, __ATOMIC_RELAXED);
+	return rec;
+}
+
+// a few stores, and a syscall only to wake the log thread when it sleeps on an empty
+// ring. Without it (another thread, or no log thread) the message is written at once.
+void Log(int id, long a0, long a1, long a2, long a3, long a4, long a5, long a6, long a7)
+{
+	struct LOG_REC local, *rec;
+
+	if ((rec = log_producer ? log_claim() : &local) == NULL)
+		return;
+	rec->id = id;
+	rec->a[0] = a0;
+	rec->a[1] = a1;
+	rec->a[2] = a2;
+	rec->a[3] = a3;
+	rec->a[4] = a4;
+	rec->a[5] = a5;
+	rec->a[6] = a6;
+	rec->a[7] = a7;
+	if (rec == &local)
+		log_emit(rec);
+	else
+		oregon_ring_push(&log_ring);
+}
+
+// sleeps until a record is pushed or log_end() closes the ring
+static void *log_writer(void *arg)
+{
+	struct LOG_REC *rec, end;
+
+	while (!oregon_ring_done(&log_ring)) {
+		if ((rec = (struct LOG_REC *)oregon_ring_peek(&log_ring)) == NULL) {
+			oregon_ring_wait_data(&log_ring, -1);
+			continue;
+		}
+		log_emit(rec);
+		oregon_ring_pop(&log_ring);
+	}
+	end.id = -1;	// only the suppressed and dropped counts
+	log_emit(&end);
+	return NULL;
+}
+
+// log thread: rate limit, then the text - each line of it on its own, as Msg() writes it
+static void log_emit(struct LOG_REC *rec)
+{
+	static time_t window[LOG_IDS];
+	static unsigned int count[LOG_IDS];
+	static unsigned long suppressed[LOG_IDS];
+	static uint32_t dropped_seen = 0;
+	char buf[4 * LINELEN], *line, *nl;
+	uint32_t dropped;
+	time_t now = time(NULL);
+	int id;
+
+	for(id = 0; id < LOG_IDS; id++) {
+		if (suppressed[id] && (now != window[id] || rec->id < 0)) {
+			snprintf(buf, sizeof(buf), "(%lu more \"%.32s\" messages suppressed)", suppressed[id],
+					(id == LOG_TEXT) ? "other" : log_fmts[id].fmt);
+			msg_out(buf);
+			suppressed[id] = 0;
+		}
+	}
+	dropped = __atomic_load_n(&log_dropped, __ATOMIC_RELAXED);
+	if (dropped != dropped_seen) {
+		snprintf(buf, sizeof(buf), "(%u log messages dropped - logging too far behind)", dropped - dropped_seen);
+		msg_out(buf);
+		dropped_seen = dropped;
+	}
+	if ((id = rec->id) < 0)
+		return;
+	if (log_fmts[id].per_s) {
+		if (now != window[id]) {
+			window[id] = now;
+			count[id] = 0;
+		}
+		if (++count[id] > (unsigned int)log_fmts[id].per_s) {
+			suppressed[id]++;
+			return;
+		}
+	}
+	if (id == LOG_TEXT)
+		snprintf(buf, sizeof(buf), "%s", rec->text);
+	else
+		log_format(buf, sizeof(buf), log_fmts[id].fmt, rec->a);
+	for(line = buf; (nl = strchr(line, '\n')) != NULL; line = nl + 1) {
+		*nl = 0;
+		msg_out(line);
+	}
+	msg_out(line);
+}
+
+// printf with long arguments: an 'l' is put into every conversion, %D is shown as tenths
+static void log_format(char *buf, size_t size, const char *fmt, const long *a)
+{
+	char spec[16];
+	size_t n = 0, k;
+	int i = 0;
+
+	while (*fmt && n < size - 1) {
+		if (*fmt != '%' || fmt[1] == '%') {
+			buf[n++] = *fmt;
+			fmt += (*fmt == '%') ? 2 : 1;
+			continue;
+		}
+		k = 1 + strspn(fmt + 1, "-+ #0123456789.");
+		if (k + 3 > sizeof(spec) || !fmt[k] || i == LOG_MAX_ARGS)
+			break;
+		if (fmt[k] == 'D')
+			snprintf(buf + n, size - n, "%.1f", OREGON_TEMP_C(a[i++]));
+		else {
+			memcpy(spec, fmt, k);
+			spec[k] = 'l';
+			spec[k + 1] = fmt[k];
+			spec[k + 2] = 0;
+			snprintf(buf + n, size - n, spec, a[i++]);
+		}
+		n += strlen(buf + n);
+		fmt += k + 1;
+	}
+	buf[n] = 0;
+}
+
+void Msg(const char *fmt, ...)
+{
+	va_list ap;
+	char	errmsg[LINELEN];
+	struct LOG_REC *rec;
+
+	// the publish thread only queues the line, in order with its Log() records
+	if (log_producer) {
+		if ((rec = log_claim()) != NULL) {
+			va_start(ap, fmt);
+			vsnprintf(rec->text, LOG_TEXT_LEN, fmt, ap);
+			va_end(ap);
+			rec->id = LOG_TEXT;
+			oregon_ring_push(&log_ring);
+		}
+		return;
+	}
+	va_start(ap, fmt);
+	vsnprintf(errmsg, LINELEN-1, fmt, ap);
+	va_end(ap);
+	msg_out(errmsg);
+}
+
+void msg_out(const char *line)
+{
+	if (log2syslog > 0)
+		syslog(LOG_ERR, "%s\n", line);
+	else
+		fprintf(stderr, "%s\n", line);
+}
@@ -0,0 +1,36 @@
+/*
+ * oregon_log.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  Messages of 'oregon_read' - to stderr, or to syslog in the daemon. The
+ *  publish thread does not format or write its messages: Log() stores the
+ *  message ID and the arguments in a ring slot, and Msg() there queues its
+ *  line the same way, so the order is kept. A log thread formats and writes
+ *  them, rate limited per message.
+ */
+
+#ifndef OREGON_LOG_H_
+#define OREGON_LOG_H_
+
+#include <stdint.h>
+
+#define LINELEN 	        256
+
+// log records - the hot path stores the message ID and its arguments, the log thread
+// formats them; see log_fmts in oregon_log.cpp
+enum { LOG_TEXT, LOG_RX_AT, LOG_BURSTS, LOG_REBUILT, LOG_PKT_COUNT, LOG_READING, LOG_BLANK, LOG_STATS_RESET, LOG_EVICTED, LOG_IDS };
+
+extern int	log2syslog;				// > 0 - messages go to syslog
+extern int	log_running;			// the log thread runs
+extern __thread int log_producer;	// Msg() of this thread goes through the log ring
+
+// wait - with the ring full the producer waits instead of dropping the record
+// (the simulator, its clock stands still meanwhile)
+void    log_begin(int wait);
+void    log_end();
+void    Log(int id, long a0 = 0, long a1 = 0, long a2 = 0, long a3 = 0, long a4 = 0, long a5 = 0, long a6 = 0, long a7 = 0);
+void	Msg(const char *fmt, ...);
+void    msg_out(const char *line);
+
+#endif /* OREGON_LOG_H_ */
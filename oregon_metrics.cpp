@@ -0,0 +1,413 @@
+/*
+ * oregon_metrics.cpp
+ *
+ *  Created on: 17Oct.,2026
+ */
+
+#include "oregon_metrics.h"
+#include "oregon_server.h"
+#include "oregon_instance.h"
+#include "oregon_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+
+#define METRICS_BUF_SIZE	(OREGON_MAX_SENSORS << 14)	// rendered page per connection with the response head, 16 KB a sensor
+#define METRICS_HDR_LEN		256		// room for the response head before the page
+#define METRICS_REQ_LEN		1024	// request head
+#define METRICS_CONTENT_TYPE	"application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+// a scrape: the request head, then the response in the connection's preallocated buffer
+struct METRICS_CLIENT {
+	int	fd;
+	char	req[METRICS_REQ_LEN];
+	size_t	req_len;
+	char	*buf;		// METRICS_BUF_SIZE
+	char	*out;		// response in buf, NULL until the request is complete
+	size_t	out_len, out_pos;
+};
+
+struct METRICS_PAGE {
+	char	*buf;
+	size_t	len, size;
+	int	full;
+};
+
+char	*metrics_addr		=	NULL;
+int	metrics_fd		=	-1;
+static struct METRICS_CLIENT metrics_clients[METRICS_MAX_CLIENTS];
+static char	*metrics_buf		=	NULL;	// METRICS_MAX_CLIENTS pages, only with -M
+static int	metrics_paused		=	0;	// all scrape slots busy - new ones wait in the backlog
+
+static void    metrics_respond(struct METRICS_CLIENT *c);
+static void    metrics_close(struct METRICS_CLIENT *c);
+static void    metrics_add(struct METRICS_PAGE *pg, const char *fmt, ...);
+static void    metrics_family(struct METRICS_PAGE *pg, const char *name, const char *type, const char *help);
+static void    metrics_hist(struct METRICS_PAGE *pg, const char *name, const char *labels, oregon_hist_t *h, int negate);
+static void    metrics_render(struct METRICS_PAGE *pg);
+
+// -M: HTTP/1.1 GET /metrics on a query server thread listener. The page is rendered
+// from a snapshot into the preallocated buffer of the connection, behind room for
+// the response head, and the connection is closed when it is sent.
+// The pages are allocated only with -M - under -T all memory is locked.
+void metrics_begin()
+{
+	int i;
+
+	if (!metrics_addr)
+		return;
+	if ((metrics_fd = (metrics_addr[0] == '/') ? unix_listen(metrics_addr, SOCK_STREAM) :
+			tcp_listen(atoi(metrics_addr))) == -1) {
+		Msg("Cannot serve metrics on %s (%s) - no metrics.", metrics_addr, strerror(errno));
+		return;
+	}
+	if (!(metrics_buf = (char *)malloc(METRICS_MAX_CLIENTS * METRICS_BUF_SIZE))) {
+		Msg("No memory for the metrics pages - no metrics.");
+		metrics_end();
+		return;
+	}
+	for(i = 0; i < METRICS_MAX_CLIENTS; i++) {
+		metrics_clients[i].fd = -1;
+		metrics_clients[i].buf = metrics_buf + i * METRICS_BUF_SIZE;
+	}
+}
+
+void metrics_end()
+{
+	if (metrics_fd != -1) {
+		close(metrics_fd);
+		if (metrics_addr[0] == '/')
+			unlink(metrics_addr);
+		metrics_fd = -1;
+	}
+	free(metrics_buf);
+	metrics_buf = NULL;
+}
+
+struct METRICS_CLIENT *metrics_client(void *ptr)
+{
+	struct METRICS_CLIENT *c = (struct METRICS_CLIENT *)ptr;
+
+	return (c >= metrics_clients && c < metrics_clients + METRICS_MAX_CLIENTS) ? c : NULL;
+}
+
+void metrics_close_all()
+{
+	int i;
+
+	for(i = 0; i < METRICS_MAX_CLIENTS; i++)
+		if (metrics_clients[i].fd != -1)
+			metrics_close(&metrics_clients[i]);
+}
+
+void metrics_accept(int epfd)
+{
+	struct epoll_event ev;
+	struct METRICS_CLIENT *c;
+	int fd, i;
+
+	while (1) {
+		for(i = 0, c = NULL; i < METRICS_MAX_CLIENTS && !c; i++)
+			if (metrics_clients[i].fd == -1)
+				c = &metrics_clients[i];
+		if (!c) {		// all busy - the next scrapes wait in the backlog, see metrics_close()
+			ev.events = 0;
+			ev.data.ptr = &metrics_fd;
+			epoll_ctl(epfd, EPOLL_CTL_MOD, metrics_fd, &ev);
+			metrics_paused = 1;
+			return;
+		}
+		if ((fd = accept4(metrics_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) == -1)
+			return;
+		c->fd = fd;
+		c->req_len = 0;
+		c->out = NULL;
+		ev.events = EPOLLIN;
+		ev.data.ptr = c;
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0)
+			metrics_close(c);
+	}
+}
+
+void metrics_serve(int epfd, struct METRICS_CLIENT *c, uint32_t events)
+{
+	struct epoll_event ev;
+	ssize_t len;
+
+	if (events & EPOLLERR) {
+		metrics_close(c);
+		return;
+	}
+	if (!c->out && (events & (EPOLLIN | EPOLLHUP))) {
+		len = recv(c->fd, c->req + c->req_len, METRICS_REQ_LEN - 1 - c->req_len, 0);
+		if (len == 0 || (len == -1 && errno != EAGAIN && errno != EINTR)) {
+			metrics_close(c);
+			return;
+		}
+		if (len > 0) {
+			c->req_len += len;
+			c->req[c->req_len] = '\0';
+			if (strstr(c->req, "\r\n\r\n") || c->req_len == METRICS_REQ_LEN - 1)
+				metrics_respond(c);
+		}
+	}
+	while (c->out && c->out_pos < c->out_len) {
+		if ((len = send(c->fd, c->out + c->out_pos, c->out_len - c->out_pos, MSG_NOSIGNAL)) == -1) {
+			if (errno != EAGAIN && errno != EINTR) {
+				metrics_close(c);
+				return;
+			}
+			break;
+		}
+		c->out_pos += len;
+	}
+	if (c->out && c->out_pos == c->out_len) {
+		metrics_close(c);		// Connection: close
+		return;
+	}
+	ev.events = c->out ? EPOLLOUT : EPOLLIN;
+	ev.data.ptr = c;
+	if (epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev) != 0)
+		metrics_close(c);
+}
+
+static void metrics_respond(struct METRICS_CLIENT *c)
+{
+	struct METRICS_PAGE pg;
+	const char *status = "200 OK", *path;
+	char head[METRICS_HDR_LEN];
+	int hlen, head_only, plen;
+
+	pg.buf = c->buf + METRICS_HDR_LEN;
+	pg.size = METRICS_BUF_SIZE - METRICS_HDR_LEN;
+	pg.len = 0;
+	pg.full = 0;
+	head_only = !strncmp(c->req, "HEAD ", 5);
+	path = strchr(c->req, ' ');
+	plen = path ? strcspn(++path, " ?\r\n") : 0;
+	if (!strstr(c->req, "\r\n\r\n"))
+		status = "400 Bad Request";
+	else if (strncmp(c->req, "GET ", 4) && !head_only)
+		status = "405 Method Not Allowed";
+	else if (!((plen == 8 && !strncmp(path, "/metrics", 8)) || (plen == 1 && *path == '/')))
+		status = "404 Not Found";
+	else {
+		metrics_render(&pg);
+		if (pg.full) {
+			Msg("Metrics page larger than %d bytes - not sent.", METRICS_BUF_SIZE - METRICS_HDR_LEN);
+			status = "500 Internal Server Error";
+		}
+	}
+	if (strcmp(status, "200 OK"))
+		pg.len = 0;
+	hlen = snprintf(head, sizeof(head), "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %lu\r\n"
+			"Connection: close\r\n\r\n", status, pg.len ? METRICS_CONTENT_TYPE : "text/plain",
+			(unsigned long)pg.len);
+	c->out = pg.buf - hlen;
+	memcpy(c->out, head, hlen);
+	c->out_len = hlen + (head_only ? 0 : pg.len);
+	c->out_pos = 0;
+}
+
+static void metrics_close(struct METRICS_CLIENT *c)
+{
+	struct epoll_event ev;
+
+	close(c->fd);
+	c->fd = -1;
+	c->out = NULL;
+	if (metrics_paused) {
+		ev.events = EPOLLIN;
+		ev.data.ptr = &metrics_fd;
+		epoll_ctl(query_epfd, EPOLL_CTL_MOD, metrics_fd, &ev);
+		metrics_paused = 0;
+	}
+}
+
+static void metrics_add(struct METRICS_PAGE *pg, const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	if (pg->full)
+		return;
+	va_start(ap, fmt);
+	len = vsnprintf(pg->buf + pg->len, pg->size - pg->len, fmt, ap);
+	va_end(ap);
+	if (len < 0 || (size_t)len >= pg->size - pg->len)
+		pg->full = 1;
+	else
+		pg->len += len;
+}
+
+static void metrics_family(struct METRICS_PAGE *pg, const char *name, const char *type, const char *help)
+{
+	metrics_add(pg, "# TYPE %s %s\n# HELP %s %s\n", name, type, name, help);
+}
+
+// only the buckets with samples, cumulative, ascending le; an RSSI histogram holds -dBm,
+// so its buckets are taken from the top
+static void metrics_hist(struct METRICS_PAGE *pg, const char *name, const char *labels, oregon_hist_t *h, int negate)
+{
+	const char *sep = labels[0] ? "," : "";
+	uint32_t sum = 0;
+	int i, last = OREGON_HIST_BUCKETS - 1;
+
+	for(i = 0; i < OREGON_HIST_BUCKETS; i++) {
+		int b = negate ? last - i : i;
+
+		if (!h->count[b] || (!negate && b == last))		// the last one holds all larger values
+			continue;
+		sum += h->count[b];
+		if (negate)
+			metrics_add(pg, "%s_bucket{%s%sle=\"%d.0\"} %u\n", name, labels, sep, -(int)oregon_hist_bucket_low(b), sum);
+		else
+			metrics_add(pg, "%s_bucket{%s%sle=\"%u.0\"} %u\n", name, labels, sep, oregon_hist_bucket_high(b), sum);
+	}
+	metrics_add(pg, "%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, sep, h->total);
+	if (negate)		// no sum of negative values, and so no count (the +Inf bucket)
+		return;
+	if (labels[0])
+		metrics_add(pg, "%s_count{%s} %u\n%s_sum{%s} %llu\n", name, labels, h->total, name, labels,
+				(unsigned long long)h->sum);
+	else
+		metrics_add(pg, "%s_count %u\n%s_sum %llu\n", name, h->total, name, (unsigned long long)h->sum);
+}
+
+static void metrics_render(struct METRICS_PAGE *pg)
+{
+	struct INSTANCE *snap = query_snap;
+	static const char *err_kind[6] = { "brst1", "brst2", "mburst", "pktlen", "bfmatch", "chksum" };
+	static const char *hist_name[4] = { "rssi_dbm", "lqi", "interval_seconds", "latency_microseconds" };
+	static const char *hist_help[4] = { "RSSI of good packets", "LQI of good packets",
+			"Time between good packets", "Time from the end of a packet to its publication" };
+	static const char *radio_mode_name[RADIO_MODES] = { "rx", "wor", "sleep" };
+	char lbl[OREGON_MAX_SENSORS][48], name[64];
+	unsigned int errs[6];
+	struct SENSOR *s;
+	int i, k;
+
+	shm_snapshot(my_instance, snap, 1);
+	for(i = 0; i < OREGON_MAX_SENSORS; i++)
+		snprintf(lbl[i], sizeof(lbl[i]), "id=\"%04X\",channel=\"%u\",roll=\"%02X\"", snap->sensors[i].oregon_data.sensor_id,
+				snap->sensors[i].oregon_data.channel, snap->sensors[i].oregon_data.roll_code);
+	errs[0] = snap->brst1_errors;
+	errs[1] = snap->brst2_errors;
+	errs[2] = snap->mbrst_errors;
+	errs[3] = snap->pktlen_errors;
+	errs[4] = snap->buffmatch_errors;
+	errs[5] = snap->chksum_errors;
+
+	// receiver
+	metrics_family(pg, "oregon_rx_packets", "counter", "Oregon packets received");
+	metrics_add(pg, "oregon_rx_packets_total %lu\n", snap->total_reads);
+	metrics_family(pg, "oregon_rx_good_packets", "counter", "Good Oregon packets");
+	metrics_add(pg, "oregon_rx_good_packets_total %lu\n", snap->good_reads);
+	metrics_family(pg, "oregon_rx_combined_packets", "counter", "Good packets rebuilt from 2 bad bursts");
+	metrics_add(pg, "oregon_rx_combined_packets_total %lu\n", snap->combined_reads);
+	metrics_family(pg, "oregon_rx_dropped_bursts", "counter", "Bursts dropped, decoding too far behind");
+	metrics_add(pg, "oregon_rx_dropped_bursts_total %lu\n", snap->rx_dropped);
+	metrics_family(pg, "oregon_rx_errors", "counter", "Rx errors by kind");
+	for(k = 0; k < 6; k++)
+		metrics_add(pg, "oregon_rx_errors_total{kind=\"%s\"} %u\n", err_kind[k], errs[k]);
+	metrics_family(pg, "oregon_rx_sync", "counter", "Sync found at bit offset");
+	for(k = 0; k < OREGON_SYNC_NOT_FOUND; k++)
+		metrics_add(pg, "oregon_rx_sync_total{offset=\"%d\"} %lu\n", k, snap->sync_hits[k]);
+	metrics_add(pg, "oregon_rx_sync_total{offset=\"none\"} %lu\n", snap->sync_hits[OREGON_SYNC_NOT_FOUND]);
+	metrics_family(pg, "oregon_rx_sensors", "gauge", "Sensors in the table");
+	metrics_add(pg, "oregon_rx_sensors %u\n", snap->sensor_count);
+	metrics_family(pg, "oregon_rx_sensor_evictions", "counter", "Sensors replaced in a full table");
+	metrics_add(pg, "oregon_rx_sensor_evictions_total %lu\n", snap->sensor_evictions);
+	metrics_family(pg, "oregon_rx_last_update_timestamp_seconds", "gauge", "Time of the last good packet");
+	metrics_add(pg, "oregon_rx_last_update_timestamp_seconds %lu\n", (unsigned long)snap->last_upd_time);
+	metrics_family(pg, "oregon_rx_data_invalid_timeout_seconds", "gauge", "Age after which a reading is invalid");
+	metrics_add(pg, "oregon_rx_data_invalid_timeout_seconds %d\n", snap->data_invalid_timeout);
+	if (snap->min_intvl <= snap->max_intvl) {
+		metrics_family(pg, "oregon_rx_interval_min_seconds", "gauge", "Min time between good packets");
+		metrics_add(pg, "oregon_rx_interval_min_seconds %u\n", snap->min_intvl);
+		metrics_family(pg, "oregon_rx_interval_max_seconds", "gauge", "Max time between good packets");
+		metrics_add(pg, "oregon_rx_interval_max_seconds %u\n", snap->max_intvl);
+		metrics_family(pg, "oregon_rx_temperature_variation_max_celsius", "gauge", "Max T variation between updates");
+		metrics_add(pg, "oregon_rx_temperature_variation_max_celsius %.1f\n", OREGON_TEMP_C(snap->max_temp_diff));
+	}
+	if (snap->good_reads > 0) {
+		metrics_family(pg, "oregon_rx_rssi_min_dbm", "gauge", "Min RSSI of good packets");
+		metrics_add(pg, "oregon_rx_rssi_min_dbm %d\n", snap->rssi_min);
+		metrics_family(pg, "oregon_rx_rssi_max_dbm", "gauge", "Max RSSI of good packets");
+		metrics_add(pg, "oregon_rx_rssi_max_dbm %d\n", snap->rssi_max);
+		metrics_family(pg, "oregon_rx_lqi_min", "gauge", "Min LQI of good packets");
+		metrics_add(pg, "oregon_rx_lqi_min %u\n", snap->lqi_min);
+		metrics_family(pg, "oregon_rx_lqi_max", "gauge", "Max LQI of good packets");
+		metrics_add(pg, "oregon_rx_lqi_max %u\n", snap->lqi_max);
+	}
+	for(k = 0; k < 4; k++) {
+		snprintf(name, sizeof(name), "oregon_rx_%s", hist_name[k]);
+		metrics_family(pg, name, "histogram", hist_help[k]);
+		metrics_hist(pg, name, "", &snap->hists.rssi + k, k == 0);
+	}
+	metrics_family(pg, "oregon_rx_service_latency_microseconds", "histogram", "Time from the end of a burst to its FIFO read");
+	metrics_hist(pg, "oregon_rx_service_latency_microseconds", "", &snap->service, 0);
+	metrics_family(pg, "oregon_rx_service_latency_max_microseconds", "gauge", "Worst time from the end of a burst to its FIFO read");
+	metrics_add(pg, "oregon_rx_service_latency_max_microseconds %u\n", snap->service_max_us);
+	metrics_family(pg, "oregon_radio_mode_seconds", "counter", "Time the radio listened (rx), was on WOR (wor) or powered down (sleep)");
+	for(k = 0; k < RADIO_MODES; k++)
+		metrics_add(pg, "oregon_radio_mode_seconds_total{mode=\"%s\"} %.3f\n", radio_mode_name[k], snap->radio_ms[k] / 1000.0);
+	metrics_family(pg, "oregon_radio_mode_messages", "counter", "Messages first heard in each radio mode");
+	for(k = 0; k < RADIO_MODES; k++)
+		metrics_add(pg, "oregon_radio_mode_messages_total{mode=\"%s\"} %llu\n", radio_mode_name[k], (unsigned long long)snap->radio_msgs[k]);
+	if (snap->wor_event0_us) {
+		metrics_family(pg, "oregon_radio_wor_period_seconds", "gauge", "WOR wake-up period (EVENT0)");
+		metrics_add(pg, "oregon_radio_wor_period_seconds %.6f\n", snap->wor_event0_us / 1e6);
+		metrics_family(pg, "oregon_radio_wor_listen_seconds", "gauge", "WOR listening per wake-up without a carrier");
+		metrics_add(pg, "oregon_radio_wor_listen_seconds %.6f\n", snap->wor_listen_us / 1e6);
+	}
+	metrics_family(pg, "oregon_radio_wakeups", "counter", "Radio loop wakeups");
+	metrics_add(pg, "oregon_radio_wakeups_total %llu\n", (unsigned long long)snap->radio_wakeups);
+
+	// sensors
+	metrics_family(pg, "oregon_sensor_temperature_celsius", "gauge", "Latest temperature");
+	for(i = 0, s = snap->sensors; i < OREGON_MAX_SENSORS; i++, s++)
+		if (s->used)
+			metrics_add(pg, "oregon_sensor_temperature_celsius{%s} %.1f\n", lbl[i], OREGON_TEMP_C(s->oregon_data.temp_dc));
+	metrics_family(pg, "oregon_sensor_battery_low", "gauge", "Battery low flag of the latest reading");
+	for(i = 0, s = snap->sensors; i < OREGON_MAX_SENSORS; i++, s++)
+		if (s->used)
+			metrics_add(pg, "oregon_sensor_battery_low{%s} %u\n", lbl[i], s->oregon_data.batt_low);
+	metrics_family(pg, "oregon_sensor_reading_rssi_dbm", "gauge", "RSSI of the latest reading");
+	for(i = 0, s = snap->sensors; i < OREGON_MAX_SENSORS; i++, s++)
+		if (s->used)
+			metrics_add(pg, "oregon_sensor_reading_rssi_dbm{%s} %d\n", lbl[i], s->oregon_data.rssi_dbm);
+	metrics_family(pg, "oregon_sensor_reading_lqi", "gauge", "LQI of the latest reading");
+	for(i = 0, s = snap->sensors; i < OREGON_MAX_SENSORS; i++, s++)
+		if (s->used)
+			metrics_add(pg, "oregon_sensor_reading_lqi{%s} %u\n", lbl[i], s->oregon_data.lqi);
+	metrics_family(pg, "oregon_sensor_last_update_timestamp_seconds", "gauge", "Time of the latest reading");
+	for(i = 0, s = snap->sensors; i < OREGON_MAX_SENSORS; i++, s++)
+		if (s->used)
+			metrics_add(pg, "oregon_sensor_last_update_timestamp_seconds{%s} %lu\n", lbl[i], (unsigned long)s->oregon_data.time);
+	metrics_family(pg, "oregon_sensor_good_packets", "counter", "Good packets of the sensor");
+	for(i = 0, s = snap->sensors; i < OREGON_MAX_SENSORS; i++, s++)
+		if (s->used)
+			metrics_add(pg, "oregon_sensor_good_packets_total{%s} %lu\n", lbl[i], s->good_reads);
+	metrics_family(pg, "oregon_sensor_combined_packets", "counter", "Good packets of the sensor rebuilt from 2 bad bursts");
+	for(i = 0, s = snap->sensors; i < OREGON_MAX_SENSORS; i++, s++)
+		if (s->used)
+			metrics_add(pg, "oregon_sensor_combined_packets_total{%s} %lu\n", lbl[i], s->combined_reads);
+	metrics_family(pg, "oregon_sensor_temperature_variation_max_celsius", "gauge", "Max T variation between updates");
+	for(i = 0, s = snap->sensors; i < OREGON_MAX_SENSORS; i++, s++)
+		if (s->used && s->good_reads > 1)
+			metrics_add(pg, "oregon_sensor_temperature_variation_max_celsius{%s} %.1f\n", lbl[i], OREGON_TEMP_C(s->max_temp_diff));
+	for(k = 0; k < 4; k++) {
+		snprintf(name, sizeof(name), "oregon_sensor_%s", hist_name[k]);
+		metrics_family(pg, name, "histogram", hist_help[k]);
+		for(i = 0, s = snap->sensors; i < OREGON_MAX_SENSORS; i++, s++)
+			if (s->used)
+				metrics_hist(pg, name, lbl[i], &snap->sensor_hists[i].rssi + k, k == 0);
+	}
+	metrics_add(pg, "# EOF\n");
+}
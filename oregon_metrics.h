@@ -0,0 +1,31 @@
+/*
+ * oregon_metrics.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  OpenMetrics exporter of 'oregon_read -M': HTTP/1.1 GET /metrics, served by
+ *  the query server thread (oregon_server.h) from a snapshot of the instance.
+ */
+
+#ifndef OREGON_METRICS_H_
+#define OREGON_METRICS_H_
+
+#include <stdint.h>
+
+#define METRICS_MAX_CLIENTS	4		// scrapes served at once
+
+struct METRICS_CLIENT;
+
+extern char	*metrics_addr;		// -M - OpenMetrics on this localhost port or socket path
+extern int	metrics_fd;			// its listening socket, -1 - none
+
+// listen and allocate the pages, before the server thread starts
+void    metrics_begin();
+void    metrics_end();
+// server thread: the client an epoll event is for, NULL - not a scrape
+struct METRICS_CLIENT *metrics_client(void *ptr);
+void    metrics_accept(int epfd);
+void    metrics_serve(int epfd, struct METRICS_CLIENT *c, uint32_t events);
+void    metrics_close_all();
+
+#endif /* OREGON_METRICS_H_ */
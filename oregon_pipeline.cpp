@@ -0,0 +1,596 @@
+/*
+ * oregon_pipeline.cpp
+ *
+ *  Created on: 17Oct.,2026
+ */
+
+#include "oregon_pipeline.h"
+#include "oregon_capture.h"
+#include "oregon_archive.h"
+#include "oregon_ring.h"
+#include "oregon_reasm.h"
+#include "oregon_log.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+
+#define PARANOID_NEEDS_BOTH_MESSAGES	0
+#define SKIP_LOG_COUNT	50  // determines frequency of log updates
+#define ARCHIVE_SYNC_MS		60000	// -A: archive pages written back at most this often
+#define THREAD_STACK_SIZE	(256 * 1024)	// helper threads - all of it is locked with -T
+#define RT_STACK_PREFAULT	(64 * 1024)	// -T: radio loop stack touched before it runs
+#define RX_RING_LEN		64		// bursts between the radio and the decode thread
+#define PUB_RING_LEN		64		// bursts and judged messages between the decode and the publish thread
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+// a burst as the radio thread hands it over: the FIFO bytes and when they came
+struct RX_BURST {
+	oregon_raw_t raw;
+	uint16_t dropped;	// bursts dropped right before this one
+	unsigned int rx_ms;	// transport->millis()
+	uint64_t rx_ns;		// end of the packet, for the publication latency (host clock)
+	unsigned int service_us;	// end of the packet to the end of the FIFO read (transport clock)
+};
+
+// what the decode thread hands over, to be applied to the instance: every burst (for the
+// capture and the Rx counters) and every message once the reassembler judged it
+enum { RX_EV_BURST, RX_EV_MESSAGE };
+
+struct RX_EVENT {
+	uint8_t	type;		// RX_EV_*
+	uint8_t	role;		// burst: OREGON_REASM_*
+	uint8_t	sync_offset;	// burst: of itself
+	struct RX_BURST b;
+	oregon_reasm_msg_t m;	// message: tag is rx_ns of its last burst
+};
+
+char	*capture_path		=	NULL;
+char	*archive_path		=	NULL;
+int	rt_prio			=	0;
+int	rt_cpu			=	-1;
+int	sched_rx		=	0;
+int	wor_rx			=	0;
+oregon_sched_t rx_sched;
+int	radio_mode		=	RADIO_RX;
+uint32_t radio_wakeups;
+uint32_t wor_repeat_ms;
+
+static oregon_ring_t rx_ring, pub_ring;
+static struct RX_BURST rx_bursts[RX_RING_LEN];
+static struct RX_EVENT pub_events[PUB_RING_LEN];
+static pthread_t decode_thread, publish_thread;
+// radio thread counters, taken over into the instance by the publish thread
+static uint32_t radio_ms[RADIO_MODES], radio_msgs[RADIO_MODES];
+static uint32_t radio_wor_us[2];		// event0, listening
+// of the publish thread - the radio thread keeps its own timing
+static unsigned int uCurrTime;
+static FILE	*capture_file		=	NULL;
+static oregon_archive_t *archive_map	=	NULL;
+static int	archive_fd		=	-1;
+static unsigned int archive_sync_ms;
+
+static void    prefault_stack();
+static void   *decode_bursts(void *arg);
+static struct RX_EVENT *decode_event(int type);
+static void    decode_messages(oregon_reasm_msg_t *m, int n);
+static void   *publish_events(void *arg);
+static void    publish_event(struct RX_EVENT *ev);
+static void    publish_burst(struct RX_EVENT *ev);
+static void    publish_message(oregon_reasm_msg_t *m);
+static void    publish_radio();
+static void    sched_burst(oregon_raw_t *raw, unsigned int rx_ms);
+static void    capture_burst(oregon_raw_t *raw, uint8_t slot, uint8_t burst);
+static void    archive_add(oregon_data_t *r);
+
+uint64_t mono_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//-----------------------[receiver pipeline]------------------------------------
+int pipeline_begin()
+{
+	int ok;
+
+	oregon_ring_init(&rx_ring, rx_bursts, sizeof(rx_bursts[0]), RX_RING_LEN);
+	oregon_ring_init(&pub_ring, pub_events, sizeof(pub_events[0]), PUB_RING_LEN);
+	ok = start_thread(&publish_thread, publish_events);
+	if (ok && !(ok = start_thread(&decode_thread, decode_bursts))) {
+		oregon_ring_close(&pub_ring);
+		pthread_join(publish_thread, NULL);
+	}
+	if (!ok)
+		Msg("Cannot start the receiver threads.");
+	return ok;
+}
+
+// a helper thread: normal policy, a small stack (it is locked with -T), no signals -
+// those stay with the radio loop
+int start_thread(pthread_t *thread, void *(*fn)(void *))
+{
+	pthread_attr_t attr;
+	sigset_t all, old;
+	int res;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, THREAD_STACK_SIZE);
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	res = pthread_create(thread, &attr, fn, NULL);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	pthread_attr_destroy(&attr);
+	return res == 0;
+}
+
+// -T: the radio loop (this thread) under SCHED_FIFO, optionally on its own core. Called once
+// the other threads run, so they keep the normal policy and all the cores. All memory is
+// locked and faulted in (the rings, the instance, the thread stacks), so a burst never waits
+// for a page fault; each step only warns if it is not allowed.
+void realtime_begin()
+{
+	struct sched_param sp;
+	cpu_set_t cpus;
+	int res;
+
+	if (!rt_prio)
+		return;
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+		Msg("Cannot lock the memory (%s) - the radio loop may wait for page faults.", strerror(errno));
+	prefault_stack();
+	if (rt_cpu >= 0) {
+		CPU_ZERO(&cpus);
+		CPU_SET(rt_cpu, &cpus);
+		if ((res = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) != 0)
+			Msg("Cannot pin the radio loop to CPU %d (%s).", rt_cpu, strerror(res));
+	}
+	sp.sched_priority = rt_prio;
+	if ((res = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp)) != 0)
+		Msg("Cannot run the radio loop under SCHED_FIFO (%s).", strerror(res));
+	else if (test_mode)
+		Msg("Radio loop: SCHED_FIFO priority %d%s", rt_prio, (rt_cpu >= 0) ? ", pinned" : "");
+}
+
+// the stack the radio loop may grow to, faulted in (and with MCL_FUTURE locked) now
+static void prefault_stack()
+{
+	volatile uint8_t stack[RT_STACK_PREFAULT];
+	size_t i;
+
+	for(i = 0; i < sizeof(stack); i += 1024)
+		stack[i] = 0;
+}
+
+// the bursts read so far are still decoded and published
+void pipeline_end()
+{
+	oregon_ring_close(&rx_ring);
+	pthread_join(decode_thread, NULL);
+	pthread_join(publish_thread, NULL);
+}
+
+// radio thread: the FIFO is read straight into a ring slot. If the decode thread is that
+// far behind, the burst is read (the chip needs its FIFO empty) and dropped - the radio
+// never waits. The simulator does wait, its clock stands still meanwhile. rx_ns is on the
+// transport clock, which is virtual in the simulator - the publication is timed on the host.
+void rx_burst(unsigned int rx_ms, uint64_t rx_ns)
+{
+	static struct RX_BURST lost;
+	static uint16_t dropped = 0;
+	uint64_t tag_ns = sim_sensors ? mono_ns() : rx_ns;
+	struct RX_BURST *b;
+
+	while ((b = (struct RX_BURST *)oregon_ring_claim(&rx_ring)) == NULL && sim_sensors)
+		oregon_ring_wait_space(&rx_ring, EVENT_WAIT_MS);
+	if (!b) {
+		cc1101_oregon.get_oregon_fifo(&lost.raw);
+		sched_burst(&lost.raw, rx_ms);
+		if (dropped < UINT16_MAX)
+			dropped++;
+		return;
+	}
+	cc1101_oregon.get_oregon_fifo(&b->raw);
+	b->service_us = (transport->nanos() - rx_ns) / 1000;
+	b->dropped = dropped;
+	b->rx_ms = rx_ms;
+	b->rx_ns = tag_ns;
+	sched_burst(&b->raw, rx_ms);
+	oregon_ring_push(&rx_ring);
+	dropped = 0;
+}
+
+// decode thread: the reassembler pairs the bursts of each sensor, whatever comes in between.
+// When no burst comes, the open messages still time out - the transport time is then taken
+// as that of the last burst plus the time since it. It waits for the publish thread, the
+// radio ring takes the slack.
+static void *decode_bursts(void *arg)
+{
+	static oregon_reasm_t reasm;
+	static oregon_reasm_msg_t done[OREGON_REASM_SLOTS];
+	struct RX_BURST *b;
+	struct RX_EVENT *ev;
+	unsigned int last_ms = 0;
+	uint64_t last_ns = mono_ns();
+	uint8_t role, sync_offset;
+	int n, wait_ms;
+
+	oregon_reasm_init(&reasm, PARANOID_NEEDS_BOTH_MESSAGES);
+	while (!oregon_ring_done(&rx_ring)) {
+		if ((b = (struct RX_BURST *)oregon_ring_peek(&rx_ring)) == NULL) {
+			wait_ms = oregon_reasm_next_ms(&reasm, last_ms + (mono_ns() - last_ns) / 1000000);
+			oregon_ring_wait_data(&rx_ring, (wait_ms < 0) ? EVENT_WAIT_MS : MIN(wait_ms, EVENT_WAIT_MS));
+			if (oregon_ring_peek(&rx_ring) == NULL) {
+				n = oregon_reasm_expire(&reasm, last_ms + (mono_ns() - last_ns) / 1000000, done);
+				decode_messages(done, n);
+			}
+			continue;
+		}
+		n = oregon_reasm_add(&reasm, &b->raw, b->rx_ms, b->rx_ns, &role, &sync_offset, done);
+		ev = decode_event(RX_EV_BURST);
+		ev->b = *b;
+		ev->role = role;
+		ev->sync_offset = sync_offset;
+		oregon_ring_push(&pub_ring);
+		decode_messages(done, n);
+		last_ms = b->rx_ms;
+		last_ns = b->rx_ns;
+		oregon_ring_pop(&rx_ring);
+	}
+	decode_messages(done, oregon_reasm_flush(&reasm, done));
+	oregon_ring_close(&pub_ring);
+	return NULL;
+}
+
+static struct RX_EVENT *decode_event(int type)
+{
+	struct RX_EVENT *ev;
+
+	while ((ev = (struct RX_EVENT *)oregon_ring_claim(&pub_ring)) == NULL)
+		oregon_ring_wait_space(&pub_ring, EVENT_WAIT_MS);
+	ev->type = type;
+	return ev;
+}
+
+static void decode_messages(oregon_reasm_msg_t *m, int n)
+{
+	int i;
+
+	for(i = 0; i < n; i++) {
+		decode_event(RX_EV_MESSAGE)->m = m[i];
+		oregon_ring_push(&pub_ring);
+	}
+}
+
+// publish thread: the only writer of the instance once the pipeline runs
+static void *publish_events(void *arg)
+{
+	struct RX_EVENT *ev;
+
+	log_producer = log_running;
+	while (!oregon_ring_done(&pub_ring)) {
+		if ((ev = (struct RX_EVENT *)oregon_ring_peek(&pub_ring)) != NULL) {
+			publish_event(ev);
+			oregon_ring_pop(&pub_ring);
+		} else
+			oregon_ring_wait_data(&pub_ring, EVENT_WAIT_MS);
+		publish_radio();
+		if (clear_stats) { // reset statistics has been requested
+			clear_stats = 0;
+			shm_write_begin(my_instance);
+			init_inst_struct(my_instance, 0);
+			shm_write_end(my_instance);
+			Log(LOG_STATS_RESET);
+		}
+	}
+	publish_radio();
+	return NULL;
+}
+
+static void publish_event(struct RX_EVENT *ev)
+{
+	if (ev->type == RX_EV_BURST)
+		publish_burst(ev);
+	else
+		publish_message(&ev->m);
+}
+
+// every burst is captured as it came, with its role in the message (a spurious repeat
+// as the third burst); its sync is counted here, a message is counted once
+static void publish_burst(struct RX_EVENT *ev)
+{
+	uCurrTime = ev->b.rx_ms;
+	capture_burst(&ev->b.raw, (ev->role == OREGON_REASM_SECOND) ? OREGON_CAP_SLOT_SECOND : OREGON_CAP_SLOT_FIRST,
+			ev->role - OREGON_REASM_FIRST);
+	shm_write_begin(my_instance);
+	my_instance->rx_dropped += ev->b.dropped;
+	update_service_stats(my_instance, ev->b.service_us);
+	update_sync_stats(my_instance, ev->sync_offset);
+	if (ev->role == OREGON_REASM_SPURIOUS) {
+		my_instance->total_reads++;
+		my_instance->mbrst_errors++;
+	}
+	shm_write_end(my_instance);
+}
+
+static void publish_message(oregon_reasm_msg_t *m)
+{
+	oregon_message_t *msg = &m->msg;
+	unsigned int latency_us; // packet end (GDO2 edge or its detection) to publication
+
+	uCurrTime = m->time_ms;
+	if (test_mode)
+		Log(LOG_RX_AT, uCurrTime/1000, uCurrTime % 1000);
+	if (debug_level > 1)
+		Log(LOG_BURSTS, msg->res1, msg->res2, msg->frame1.len, msg->frame2.len);
+	if (msg->combined && debug_level > 0)
+		Log(LOG_REBUILT, msg->conflicts);
+	latency_us = (mono_ns() - m->tag) / 1000;
+	// the whole message is published at once - readers never see half of it
+	shm_write_begin(my_instance);
+	my_instance->total_reads++;
+	if (msg->good)
+	{
+		msg->reading.time = time(NULL);
+		my_instance->oregon_data = msg->reading;
+		my_instance->good_reads++;
+		if (msg->combined)
+			my_instance->combined_reads++;
+		update_global_stats(my_instance, msg, latency_us);
+		update_sensor(my_instance, msg, uCurrTime, latency_us);
+		if (sim_sensors)
+			sim_transport.check_reading(&msg->reading, uCurrTime);
+		my_instance->last_upd_time = msg->reading.time;
+	}
+	if (!msg->res1)
+		my_instance->brst1_errors++;
+	if (!msg->res2)
+		my_instance->brst2_errors++;
+	if (msg->pktlen < THN122N_MIN_PKTLEN_FOR_DECODE)
+		my_instance->pktlen_errors++;
+	if (msg->buffdiff)
+		my_instance->buffmatch_errors++;
+	if (!msg->cksum_ok)
+		my_instance->chksum_errors++;
+	shm_write_end(my_instance);
+	if (msg->good) {
+		notify_readings(my_instance);
+		archive_add(&msg->reading);
+		if (debug_level) {
+			Msg("=== Rx stats ====");
+			disp_rx_stats(my_instance);
+		} else {
+			if (test_mode && ((my_instance->total_reads % SKIP_LOG_COUNT) == 1))
+				Log(LOG_PKT_COUNT, my_instance->total_reads - my_instance->good_reads, my_instance->total_reads);
+		}
+		if (test_mode) {
+			if (debug_level) {
+				Msg("=== Decoded packet ==");
+			}
+			Log(LOG_READING, msg->reading.rssi_dbm, msg->reading.lqi, msg->reading.sensor_id, msg->reading.channel,
+					msg->reading.roll_code, msg->reading.batt_low, msg->reading.cksum_ok, msg->reading.temp_dc);
+		}
+	}
+	if (test_mode)
+		Log(LOG_BLANK);
+}
+
+// the radio counters into the instance, as much as they grew since the last time
+static void publish_radio()
+{
+	static uint32_t seen_ms[RADIO_MODES], seen_msgs[RADIO_MODES], seen_wakeups, seen_wor_us[2];
+	uint32_t ms[RADIO_MODES], msgs[RADIO_MODES], wakeups, wor_us[2];
+	int m, changed;
+
+	wakeups = __atomic_load_n(&radio_wakeups, __ATOMIC_RELAXED);
+	changed = (wakeups != seen_wakeups);
+	for(m = 0; m < RADIO_MODES; m++) {
+		ms[m] = __atomic_load_n(&radio_ms[m], __ATOMIC_RELAXED);
+		msgs[m] = __atomic_load_n(&radio_msgs[m], __ATOMIC_RELAXED);
+		changed |= (ms[m] != seen_ms[m]) || (msgs[m] != seen_msgs[m]);
+	}
+	for(m = 0; m < 2; m++) {
+		wor_us[m] = __atomic_load_n(&radio_wor_us[m], __ATOMIC_RELAXED);
+		changed |= (wor_us[m] != seen_wor_us[m]);
+	}
+	if (!changed)
+		return;
+	shm_write_begin(my_instance);
+	for(m = 0; m < RADIO_MODES; m++) {
+		my_instance->radio_ms[m] += ms[m] - seen_ms[m];
+		my_instance->radio_msgs[m] += msgs[m] - seen_msgs[m];
+		seen_ms[m] = ms[m];
+		seen_msgs[m] = msgs[m];
+	}
+	my_instance->radio_wakeups += wakeups - seen_wakeups;
+	seen_wakeups = wakeups;
+	my_instance->wor_event0_us = seen_wor_us[0] = wor_us[0];
+	my_instance->wor_listen_us = seen_wor_us[1] = wor_us[1];
+	shm_write_end(my_instance);
+}
+//-------------------------------[end]------------------------------------------
+
+//-----------------------[receive schedule]-------------------------------------
+// -s, -w: the radio thread keeps the schedule itself. It learns from the sensor of every burst
+// it reads, decoded right after the FIFO read (a few us), so whether to listen never
+// depends on how far the other threads are. The spacing of the bursts of a message, which
+// WOR is tuned to, is only measured in continuous RX - on WOR a burst may be caught late
+// in its preamble, its sync and end come later then.
+static void sched_burst(oregon_raw_t *raw, unsigned int rx_ms)
+{
+	oregon_frame_t frame;
+	uint32_t d;
+
+	if (!(sched_rx || wor_rx) || oregon_decode_frame(raw->data, raw->len, raw->rssi_raw, raw->lqi_raw, &frame) != OREGON_OK)
+		return;
+	d = oregon_sched_heard(&rx_sched, oregon_sched_key(&frame.reading), rx_ms);
+	if (!d)
+		__atomic_store_n(&radio_msgs[radio_mode], radio_msgs[radio_mode] + 1, __ATOMIC_RELAXED);
+	else if (radio_mode == RADIO_RX && d <= OREGON_REASM_TIMEOUT_MS)
+		wor_repeat_ms = wor_repeat_ms ? (7 * wor_repeat_ms + d + 4) / 8 : d;
+}
+
+// -w: WOR whenever the radio would listen all the time, once the burst spacing is known -
+// except while learning, which also gives the rate of messages to compare WOR with
+void radio_wor(int on)
+{
+	if (on && radio_mode != RADIO_WOR) {
+		cc1101_oregon.wor_enable(wor_repeat_ms);
+		__atomic_store_n(&radio_wor_us[0], cc1101_oregon.wor_event0_us, __ATOMIC_RELAXED);
+		__atomic_store_n(&radio_wor_us[1], cc1101_oregon.wor_listen_us, __ATOMIC_RELAXED);
+		radio_account(RADIO_WOR);
+	} else if (!on && radio_mode == RADIO_WOR) {
+		cc1101_oregon.wor_disable();
+		cc1101_oregon.receive();
+		radio_account(RADIO_RX);
+	}
+}
+
+// the radio powered down for ms (a signal ends the sleep early), then back in RX
+void radio_sleep(unsigned int ms)
+{
+	radio_account(RADIO_SLEEP);
+	cc1101_oregon.powerdown();
+	transport->delay_ms(ms);
+	cc1101_oregon.wakeup();
+	radio_account(RADIO_RX);
+}
+
+// the time since the last call goes to the mode the radio was in, mode is the one from now
+void radio_account(int mode)
+{
+	static unsigned int mark_ms;
+	static int started;
+	unsigned int now_ms = transport->millis();
+
+	if (started)
+		__atomic_store_n(&radio_ms[radio_mode], radio_ms[radio_mode] + (now_ms - mark_ms), __ATOMIC_RELAXED);
+	mark_ms = now_ms;
+	radio_mode = mode;
+	started = 1;
+}
+//-------------------------------[end]------------------------------------------
+
+void capture_begin()
+{
+	oregon_cap_header_t hdr;
+
+	if (!capture_path)
+		return;
+	if ((capture_file = fopen(capture_path, "ab")) == NULL) {
+		Msg("Cannot open capture file %s (%s) - not capturing.", capture_path, strerror(errno));
+		return;
+	}
+	if (ftell(capture_file) == 0) {
+		memset(&hdr, 0, sizeof(hdr));
+		hdr.magic = OREGON_CAP_MAGIC;
+		hdr.version = OREGON_CAP_VERSION;
+		hdr.record_size = sizeof(oregon_cap_record_t);
+		fwrite(&hdr, sizeof(hdr), 1, capture_file);
+	}
+}
+
+void capture_end()
+{
+	if (capture_file) {
+		fclose(capture_file);
+		capture_file = NULL;
+	}
+}
+
+static void capture_burst(oregon_raw_t *raw, uint8_t slot, uint8_t burst)
+{
+	oregon_cap_record_t rec;
+
+	if (!capture_file)
+		return;
+	memset(&rec, 0, sizeof(rec));
+	rec.time_ms = uCurrTime;
+	rec.slot = slot;
+	rec.burst = burst;
+	rec.len = raw->len;
+	rec.rssi_raw = raw->rssi_raw;
+	rec.lqi_raw = raw->lqi_raw;
+	memcpy(rec.data, raw->data, raw->len);
+	if (fwrite(&rec, sizeof(rec), 1, capture_file) != 1) {
+		Msg("Capture write failed (%s) - capture stopped.", strerror(errno));
+		fclose(capture_file);
+		capture_file = NULL;
+	}
+}
+
+//-----------------------[round-robin archive]----------------------------------
+// -A: the readings go to the mapped archive file as they are published, the kernel
+// writes the pages back - started every ARCHIVE_SYNC_MS without waiting for it, and
+// waited for at the end
+void archive_begin()
+{
+	struct stat sb;
+
+	if (!archive_path)
+		return;
+	if (!strcmp(archive_path, OREGON_ARCHIVE_FILE))
+		mkdir(OREGON_STATE_DIR, 0755);
+	if ((archive_fd = open(archive_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) == -1) {
+		Msg("Cannot open archive %s (%s) - not archiving.", archive_path, strerror(errno));
+		return;
+	}
+	if (flock(archive_fd, LOCK_EX | LOCK_NB) != 0 || fstat(archive_fd, &sb) != 0) {
+		Msg("Archive %s is in use (%s) - not archiving.", archive_path, strerror(errno));
+		archive_end();
+		return;
+	}
+	archive_map = (oregon_archive_t *)mmap(NULL, sizeof(oregon_archive_t), PROT_READ | PROT_WRITE, MAP_SHARED, archive_fd, 0);
+	if (archive_map == MAP_FAILED) {
+		archive_map = NULL;
+		Msg("Cannot map archive %s (%s) - not archiving.", archive_path, strerror(errno));
+		archive_end();
+		return;
+	}
+	if (!oregon_archive_valid(archive_map, sb.st_size)) {
+		// a new archive is sparse - a sensor takes disk space once it is heard
+		if (ftruncate(archive_fd, 0) != 0 || ftruncate(archive_fd, sizeof(oregon_archive_t)) != 0) {
+			Msg("Cannot size archive %s (%s) - not archiving.", archive_path, strerror(errno));
+			archive_end();
+			return;
+		}
+		oregon_archive_init(archive_map);
+	} else if (archive_map->seq & 1)	// the last daemon died while writing
+		archive_map->seq++;
+	archive_sync_ms = transport->millis();
+}
+
+static void archive_add(oregon_data_t *r)
+{
+	if (!archive_map)
+		return;
+	oregon_archive_add(archive_map, r);
+	if (transport->millis() - archive_sync_ms >= ARCHIVE_SYNC_MS) {
+		sync_file_range(archive_fd, 0, 0, SYNC_FILE_RANGE_WRITE);
+		archive_sync_ms = transport->millis();
+	}
+}
+
+void archive_end()
+{
+	if (archive_map) {
+		msync(archive_map, sizeof(oregon_archive_t), MS_SYNC);
+		munmap(archive_map, sizeof(oregon_archive_t));
+		archive_map = NULL;
+	}
+	if (archive_fd != -1) {
+		close(archive_fd);
+		archive_fd = -1;
+	}
+}
+//-------------------------------[end]------------------------------------------
@@ -0,0 +1,63 @@
+/*
+ * oregon_pipeline.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  Receiver pipeline of 'oregon_read'. The radio loop (main thread) only
+ *  drains the FIFO and timestamps the burst; a decode thread judges the bursts
+ *  and a publish thread applies them to the instance and does all the output
+ *  (capture, archive, log). They are linked by rings of preallocated slots, so
+ *  a slow syslog, console or disk write never holds up the next burst. The
+ *  receive schedule (-s, -w) is kept by the radio loop itself.
+ */
+
+#ifndef OREGON_PIPELINE_H_
+#define OREGON_PIPELINE_H_
+
+#include "cc1101_oregon.h"
+#include "cc1101_sim.h"
+#include "oregon_instance.h"
+#include "oregon_sched.h"
+#include <stdint.h>
+#include <pthread.h>
+
+#define EVENT_WAIT_MS	1000 // event mode: max. wait for GDO2, to serve stats reset/exit
+#define OREGON_ARCHIVE_FILE	OREGON_STATE_DIR "/archive"
+
+// of oregon_read.cpp
+extern CC1101_Transport *transport;
+extern CC1101_Oregon cc1101_oregon;
+extern CC1101_Sim sim_transport;
+extern int	test_mode;
+extern int	debug_level;
+extern int	sim_sensors;
+extern int	clear_stats;
+
+extern char	*capture_path;		// -C - raw bursts appended to this file
+extern char	*archive_path;		// -A - round-robin archive of the readings
+extern int	rt_prio;			// -T - SCHED_FIFO priority of the radio loop, 0 - normal
+extern int	rt_cpu;				// -T prio,cpu - core of the radio loop
+extern int	sched_rx;			// -s - listen only around the expected messages
+extern int	wor_rx;				// -w - Wake-on-Radio instead of continuous RX
+
+// of the radio thread
+extern oregon_sched_t rx_sched;
+extern int	radio_mode;			// RADIO_*
+extern uint32_t radio_wakeups;
+extern uint32_t wor_repeat_ms;	// spacing of the bursts of a message, 0 - not measured yet
+
+uint64_t mono_ns();
+int     start_thread(pthread_t *thread, void *(*fn)(void *));
+void    capture_begin();
+void    capture_end();
+void    archive_begin();
+void    archive_end();
+int     pipeline_begin();
+void    pipeline_end();
+void    realtime_begin();
+void    rx_burst(unsigned int rx_ms, uint64_t rx_ns);
+void    radio_wor(int on);
+void    radio_sleep(unsigned int ms);
+void    radio_account(int mode);
+
+#endif /* OREGON_PIPELINE_H_ */
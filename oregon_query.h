@@ -0,0 +1,80 @@
+/*
+ * oregon_query.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  Binary protocol of the query socket of 'oregon_read -Q': a local
+ *  SOCK_SEQPACKET socket, one oregon_query_t packet per request. Every reply
+ *  packet is an oregon_reply_t followed by count records of rec_size bytes;
+ *  a history reply takes several packets, the last one has more == 0.
+ *  All fields are in host byte order - the socket is local.
+ */
+
+#ifndef OREGON_QUERY_H_
+#define OREGON_QUERY_H_
+
+#include <stdint.h>
+#include "oregon_decoder.h"
+
+#define OREGON_QUERY_SOCKET		"/run/oregon_read.sock"
+#define OREGON_QUERY_VERSION	1
+
+// query types
+#define OREGON_Q_LATEST			1	// latest reading of every matching sensor - oregon_data_t
+#define OREGON_Q_STATS			2	// Rx stats of the matching sensor, or all - oregon_q_stats_t
+#define OREGON_Q_HISTORY		3	// kept readings of matching sensors, oldest first - oregon_data_t
+
+// reply status
+#define OREGON_Q_OK				0
+#define OREGON_Q_EINVAL			1	// unknown query type or version, bad length
+
+#define OREGON_Q_ANY			-1	// selector field matches any sensor
+#define OREGON_Q_MAX_RECORDS	512	// records per reply packet
+
+typedef struct {
+	uint8_t  version;				// OREGON_QUERY_VERSION
+	uint8_t  type;					// OREGON_Q_*
+	uint16_t reserved;
+	int32_t  id;					// sensor selector, as 'oregon_read -i'
+	int16_t  channel;
+	int16_t  roll_code;
+	uint32_t last;					// history: last readings per sensor, 0 - all kept
+	uint32_t since;					// history: readings since (s since epoch), 0 - all
+} oregon_query_t;
+
+typedef struct {
+	uint8_t  version;
+	uint8_t  type;					// of the query
+	uint8_t  status;				// OREGON_Q_OK ...
+	uint8_t  more;					// 1 - more reply packets follow
+	uint16_t rec_size;				// bytes per record
+	uint16_t count;					// records after this header
+	uint32_t time;					// daemon wall clock (s since epoch) - to judge reading age
+	uint32_t data_invalid_timeout;	// [s]
+} oregon_reply_t;
+
+// without a selector the global stats, else the ones of the latest matching sensor
+// (no error counters, sensor_count 1); no record if no sensor matches
+typedef struct {
+	uint64_t total_reads;
+	uint64_t good_reads;
+	uint64_t combined_reads;		// good packets rebuilt from two bad bursts
+	uint32_t brst1_errors, brst2_errors, mbrst_errors;
+	uint32_t pktlen_errors, buffmatch_errors, chksum_errors;
+	uint32_t min_intvl, max_intvl;	// [s] between good packets of a sensor, valid with min <= max
+	uint32_t last_upd_time;			// s since epoch, 0 - no data yet
+	uint32_t sensor_count;
+	int32_t  max_temp_diff;			// [0.1 degC] between updates
+	int8_t   rssi_min, rssi_avg, rssi_max;	// [dBm], valid with good_reads > 0
+	uint8_t  lqi_min, lqi_avg, lqi_max;
+	int16_t  rssi_pct[3];			// p50 / p90 / p99 [dBm], the weak tail
+	uint16_t lqi_pct[3];
+	uint32_t intvl_pct[3];			// [s]
+	uint32_t latency_pct[3];		// [us] Rx to publication
+} oregon_q_stats_t;
+
+static_assert(sizeof(oregon_query_t) == 20, "query layout");
+static_assert(sizeof(oregon_reply_t) == 16, "reply layout");
+static_assert(sizeof(oregon_q_stats_t) == 112, "stats layout");
+
+#endif /* OREGON_QUERY_H_ */
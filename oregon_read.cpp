@@ -6,10 +6,20 @@
  */
 
 #include "cc1101_oregon.h"
+#include "cc1101_sim.h"
+#include "oregon_capture.h"
+#include "oregon_hist.h"
+#include "oregon_query.h"
+#include "oregon_archive.h"
+#include "oregon_sched.h"
+#include "oregon_instance.h"
+#include "oregon_log.h"
+#include "oregon_server.h"
+#include "oregon_metrics.h"
+#include "oregon_pipeline.h"
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
-#include <stdarg.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
@@ -26,20 +36,25 @@
 #include <sys/wait.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sched.h>
+#include <stddef.h>
 #include <time.h>
 #include <linux/limits.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #include <getopt.h>
-#include <wiringPi.h>
-#include <wiringPiSPI.h>
 
 #define SHM_DEBUG	0
-#define PARANOID_NEEDS_BOTH_MESSAGES	0
 
 #define PACKAGE    "CC1101 Oregon read utility"
 #define VERSION_SW "1.53"
 
-#define OPTCHARS		"d::hobVr::Ktn:"
+#define OPTCHARS		"d::hobVr::Ktn:S::EC:i:H:P::Q::q:FM:A::R:T:sw"
 #define ARG_o			1
 #define ARG_b			(1<<1)
 #define ARG_t			(1<<2)
@@ -47,39 +62,51 @@
 #define ARG_K			(1<<4)
 #define ARG_r			(1<<5)
 #define ARG_n			(1<<6)
+#define ARG_S			(1<<7)
+#define ARG_E			(1<<8)
+#define ARG_C			(1<<9)
+#define ARG_i			(1<<10)
+#define ARG_H			(1<<11)
+#define ARG_P			(1<<12)
+#define ARG_Q			(1<<13)
+#define ARG_F			(1<<14)
+#define ARG_M			(1<<15)
+#define ARG_A			(1<<16)
+#define ARG_R			(1<<17)
+#define ARG_T			(1<<18)
+#define ARG_s			(1<<19)
+#define ARG_w			(1<<20)
+#define ARG_q			(1<<21)
 
-#define SKIP_LOG_COUNT	50  // determines frequency of log updates
 #define ADDITIONAL_DELAY_MS	100
 #define SHORT_DELAY_MS	5
 #define MSG_TIMEOUT_MS	1000
+#define WOR_REARM_MS	60000 // WOR: re-armed this often without a packet, in case a carrier kept the radio in RX
 #define OREGON_DATA_TIMEOUT_S	300
 #define OREGON_DATA_MIN_TIMEOUT_S	60
-#define LINELEN 	        256
 #define SUCCESS                  1
 #define FATALERR		-1
 #define OREAD_KEY		0x8f2a474c
 #define SHMEM_SIZE		(sizeof(struct INSTANCE))
+#define STATE_MAGIC		0x5354524f	// "ORTS"
+#define FOLLOW_WAIT_MS		1000	// -F: max. wait for a reading, to see the daemon ending
 
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX(a, b) ((a) < (b) ? (b) : (a))
-#define ABS(a) ( (a) < 0 ? (-(a)) : (a) )
-
 
 
 //--------------------------[Global CC1101 variables]--------------------------
-uint8_t rx_fifo1[FIFOBUFFER], rx_fifo2[FIFOBUFFER];
-uint8_t pktlen1, pktlen2;
-uint8_t lqi1,lqi2;
-int8_t rssi_dbm1,rssi_dbm2;
-unsigned int uCurrTime, uOldTime, uPrevTime, uIntvl_s;
-double last_temp_reading;
 
 
+#if !CC1101_NO_WIRINGPI
+CC1101_WiringPi wiringpi_transport;
+#endif
+CC1101_Sim sim_transport;
+CC1101_Transport *transport = NULL;
 CC1101_Oregon cc1101_oregon;
 
 int	debug_level			= 	0;
-int	log2syslog		= 	0;
 int	kill_proc		=	0;
 int bare_temp		=	0;
 int show_data		=	0;
@@ -87,7 +114,24 @@ int	show_verbose		=	0;
 int	test_mode		=	0;
 int	clear_stats		=	0;
 int	reset_stats		=	0;
+int	sim_sensors		=	0;
+int	event_mode		=	0;
+char	*state_path		=	NULL;	// -P - state in this file instead of SysV shm
+int	state_resumed		=	0;
 long	reset_flags		=	0xff;
+long	sel_id			=	-1;	// -i sensor selector, -1 - any
+long	sel_chan		=	-1;
+long	sel_roll		=	-1;
+int	show_history		=	0;
+int	follow			=	0;	// -F - stream new readings as they are published
+int	test_history		=	0;	// -t -H - dump the history at the end of the test
+long	hist_last		=	0;	// -H num - last num readings per sensor
+time_t	hist_since		=	0;	// -H @time - readings since time
+int	archive_tier		=	-1;	// -R tier[,from[,to]] - dump the archive
+uint32_t archive_from		=	0;
+uint32_t archive_to		=	UINT32_MAX;
+int	query_type		=	0;	// -q - one query to the daemon's socket, OREGON_Q_*
+int	query_failed		=	0;	// -t -Q: the socket did not answer as the state says
 int data_invalid_timeout = OREGON_DATA_TIMEOUT_S;
 
 int	keep_running		=	1;
@@ -96,30 +140,35 @@ char	*program		=	NULL;
 int	shmid			=	0;
 
 struct	sigaction sig;
-char    strbuf[LINELEN];
 
 //-------------------------- [End] --------------------------
 ///////////////////////////////////////////////////////////////////////////
 
-struct INSTANCE {
-	int	pid;
-	int data_invalid_timeout;
-	oregon_data_t oregon_data;
-	time_t	last_upd_time; // last time data has been received from oregon sensor
-	// statistics
-	unsigned long total_reads;
-	unsigned long good_reads;
-	unsigned int  min_intvl, max_intvl;
-	unsigned int brst1_errors, brst2_errors, mbrst_errors, pktlen_errors, buffmatch_errors, chksum_errors;
-	double max_temp_diff;
-	long	rssi_sum;
-	unsigned long	lqi_sum;
-	uint8_t lqi_max, lqi_min;
-	int8_t rssi_max, rssi_min;
-	long	reset_flags;
-} *my_instance = NULL;
-
-void    update_global_stats(struct INSTANCE *is);
+// -P: the state file is this header followed by struct INSTANCE, mapped shared
+struct STATE_FILE {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t header_size;		// offsetof(struct STATE_FILE, inst)
+	uint32_t state_size;		// sizeof(struct INSTANCE)
+	uint32_t reserved;
+	struct INSTANCE inst;
+} *state_map = NULL;
+
+// -t -Q: what a client got, the readings summed up the same way for the replies and the state
+struct QUERY_CHECK {
+	long	recs;
+	uint64_t sum;
+	oregon_q_stats_t st;
+};
+
+void    disp_history(struct INSTANCE *is, struct INSTANCE *snap);
+void    follow_readings(struct INSTANCE *is);
+int     show_query();
+void    disp_query_reply(const oregon_reply_t *rep, const void *recs, void *arg);
+void    check_queries();
+void    check_query_reply(const oregon_reply_t *rep, const void *recs, void *arg);
+void    check_query_sum(struct QUERY_CHECK *chk, const oregon_data_t *r, int n);
+void    archive_dump();
 void    do_main_cycle();
 void	process_options(int argc, char *argv[]);
 void    interact_with_daemon();
@@ -129,27 +178,34 @@ void	resetstats_handler(int signum);
 #if SHM_DEBUG
 void	dump_shm(struct shmid_ds *d);
 #endif
-void    disp_rx_stats(struct INSTANCE *is);
-void	disp_oregon_data(struct INSTANCE *is, int disp_time);
-void    init_inst_struct(struct INSTANCE *is, int clear_all);
 void    init_HW();
 int		get_shm_info();
+int		get_state_file();
+void	release_state();
+void	resume_state(struct INSTANCE *is);
+struct INSTANCE *attach_daemon(int writable);
+void	detach_daemon();
 int		run_as_background();
-void	Msg(const char *fmt, ...);
-char   *nol_ctime(const time_t *timep);
 
 
 void Usage()
 {
 	fprintf(stderr,  "\nUSAGE: %s ", program);
-	fprintf(stderr, "[ -o][ -b][ -V][ -r[flags]]");
-	fprintf(stderr, "[ -K][ -t [ -d[num]]][ -n[num]][ -h]");
+	fprintf(stderr, "[ -o][ -b][ -V][ -H num|@time][ -F][ -q type][ -i id[,ch[,roll]]][ -r[flags]]");
+	fprintf(stderr, "[ -K][ -t [ -d[num]][ -S[num[,ppm]]]][ -E][ -C file][ -Q[file]][ -M port|path][ -A[file]][ -T prio[,cpu]][ -s][ -w][ -R tier[,from[,to]]][ -P[file]][ -n[num]][ -h]");
 	fprintf(stderr, "\n\n%s, Version %s by Ivaylo Haratcherev, 2021\n", PACKAGE, VERSION_SW);
 	fprintf(stderr, "Run without options or with -n (as root) to start the listening daemon.\n");
 	fprintf(stderr, "Options: \n");
 	fprintf(stderr, "         -o               show last Oregon data collected from daemon\n");
 	fprintf(stderr, "         -b               show only temperature in bare format\n");
 	fprintf(stderr, "         -V               show daemon info + verbose Rx stats and Oregon data\n");
+	fprintf(stderr, "         -H num|@time     dump the last num readings of every sensor, or all since\n");
+	fprintf(stderr, "                          time (seconds since epoch), as CSV (%d kept)\n", OREGON_HISTORY_LEN);
+	fprintf(stderr, "         -F, --follow     stream new readings as CSV as they are received\n");
+	fprintf(stderr, "         -q type          ask the daemon on its query socket (-Q file, default %s)\n", OREGON_QUERY_SOCKET);
+	fprintf(stderr, "                          for latest, stats or history (with -H num|@time)\n");
+	fprintf(stderr, "         -i id[,ch[,roll]] with -o, -b, -V, -H, -F or -q: only the sensor with this ID (hex),\n");
+	fprintf(stderr, "                          channel and roll code, the latest one if several match\n");
 	fprintf(stderr, "         -r[flags]        reset daemon statistics counters (needs root)\n");
 	fprintf(stderr, "                          optional flags in binary form indicate \n");
 	fprintf(stderr, "                          stats to clear (LSB to MSB):\n");
@@ -161,6 +217,30 @@ void Usage()
 	fprintf(stderr, "         -K               terminate daemon instance (needs root)\n");
 	fprintf(stderr, "         -t               test mode - show Rx Oregon data as received (root)\n");
     fprintf(stderr, "         -d[num]          optional debug level num (default 1) for test mode\n");
+    fprintf(stderr, "         -S[num[,ppm]]    simulated radio with num (default 1) THN122N sensors,\n");
+    fprintf(stderr, "                          %d h of virtual time, optional bit error rate\n", SIM_DURATION_S/3600);
+    fprintf(stderr, "                          in ppm - for test mode; fails if a message is published twice\n");
+    fprintf(stderr, "         -E               event-driven Rx - wait for GDO2 edges on %s\n", GDO2_GPIOCHIP);
+    fprintf(stderr, "                          instead of polling (daemon and test mode)\n");
+    fprintf(stderr, "         -C file          append the raw FIFO bursts to a capture file for\n");
+    fprintf(stderr, "                          oregon_batch (daemon and test mode)\n");
+    fprintf(stderr, "         -Q[file]         serve binary queries (oregon_query.h) on a local socket\n");
+    fprintf(stderr, "                          (default %s) - daemon and test mode; the test checks\n", OREGON_QUERY_SOCKET);
+    fprintf(stderr, "                          the replies against its state at the end\n");
+    fprintf(stderr, "         -M port|path     serve OpenMetrics (HTTP GET /metrics) on a localhost TCP\n");
+    fprintf(stderr, "                          port or a socket path - daemon and test mode\n");
+    fprintf(stderr, "         -A[file]         keep a round-robin archive of the readings in a mapped file\n");
+    fprintf(stderr, "                          (default %s) - daemon and test mode\n", OREGON_ARCHIVE_FILE);
+    fprintf(stderr, "         -T prio[,cpu]    radio loop under SCHED_FIFO at prio, on core cpu, with all\n");
+    fprintf(stderr, "                          memory locked - daemon and test mode\n");
+    fprintf(stderr, "         -s               learn the sensor periods and power the radio down between\n");
+    fprintf(stderr, "                          the expected messages - daemon and test mode\n");
+    fprintf(stderr, "         -w               Wake-on-Radio instead of continuous RX, tuned to the measured\n");
+    fprintf(stderr, "                          burst spacing - with -E, daemon and test mode\n");
+    fprintf(stderr, "         -R tier[,from[,to]] dump the archive as CSV: raw readings, 5m or 1h min/avg/max,\n");
+    fprintf(stderr, "                          optionally from/to a time (s since epoch); -i id[,ch] selects\n");
+    fprintf(stderr, "         -P[file]         keep the state (stats, readings, history) in a mapped file\n");
+    fprintf(stderr, "                          (default %s) - kept over restarts\n", OREGON_STATE_FILE);
     fprintf(stderr, "         -n[num]          optional data invalid timeout (default %d) - dmn only\n", OREGON_DATA_TIMEOUT_S);
 	fprintf(stderr, "         -h               help (this text)\n");
 }
@@ -186,7 +266,13 @@ int main(int argc, char *argv[])
 
 	process_options(argc, argv);
 
-	if (show_verbose || bare_temp || show_data || kill_proc || reset_stats) {
+	if (archive_tier >= 0) {
+		archive_dump();
+		exit(0);
+	}
+	if (query_type)
+		exit(show_query() == FATALERR ? 1 : 0);
+	if (show_verbose || bare_temp || show_data || show_history || follow || kill_proc || reset_stats) {
 	    interact_with_daemon();
 	    exit(0);
 	}
@@ -219,160 +305,363 @@ int main(int argc, char *argv[])
 		init_HW();
 		do_main_cycle();
 		cc1101_oregon.end();
-		shmdt(shmaddr);
-		if (shmctl(shmid, IPC_RMID, NULL) != 0) {
-		    Msg("Cannot remove shared memory (%s)!", strerror(errno));
+		if (sim_sensors)
+			sim_transport.show_stats();
+		if (state_path)
+			release_state();
+		else {
+			shmdt(shmaddr);
+			if (shmctl(shmid, IPC_RMID, NULL) != 0) {
+			    Msg("Cannot remove shared memory (%s)!", strerror(errno));
+			}
+		}
+		// the simulator knows what was sent - a message must not come out twice
+		if (sim_sensors && sim_transport.readings_twice) {
+			Msg("Error! %lu readings were published twice.", sim_transport.readings_twice);
+			return FATALERR;
+		}
+		if (query_failed) {
+			Msg("Error! The query socket replies do not match the state.");
+			return FATALERR;
 		}
 	}
 	return 0;
 }
 
-void update_global_stats(struct INSTANCE *is)
+
+void disp_history(struct INSTANCE *is, struct INSTANCE *snap)
 {
-	  unsigned int uDiffTime;
-	  if (uCurrTime < uPrevTime)
-		  uDiffTime = uCurrTime + ~uPrevTime + 1;
-	  else
-		  uDiffTime = uCurrTime - uPrevTime;
-	  uIntvl_s = uDiffTime/1000 + (uDiffTime % 1000)/500;
-	  uPrevTime = uCurrTime;
-	  // update time intervals only after the second reception
-	  if (is->good_reads > 1) {
-		  is->min_intvl = MIN(is->min_intvl, uIntvl_s);
-		  is->max_intvl = MAX(is->max_intvl, uIntvl_s);
-		  is->max_temp_diff = MAX(ABS(is->oregon_data.temperature-last_temp_reading), is->max_temp_diff);
-	  }
-	  is->rssi_sum += (rssi_dbm1 + rssi_dbm2)/2;
-	  is->lqi_sum += (lqi1 + lqi2)/2;
-	  is->rssi_min = MIN(MIN(rssi_dbm1, rssi_dbm2), is->rssi_min);
-	  is->rssi_max = MAX(MAX(rssi_dbm1, rssi_dbm2), is->rssi_max);
-	  is->lqi_max = MAX(MAX(lqi1, lqi2), is->lqi_max);
-	  is->lqi_min = MIN(MIN(lqi1, lqi2), is->lqi_min);
-	  last_temp_reading = is->oregon_data.temperature;
+	static oregon_data_t r[OREGON_HISTORY_LEN];
+	int slot, i, n;
+
+	printf("time,id,channel,roll,batt,temp,rssi,lqi\n");
+	for(slot = 0; slot < OREGON_MAX_SENSORS; slot++) {
+		if (!sensor_match(&snap->sensors[slot], sel_id, sel_chan, sel_roll))
+			continue;
+		n = read_history(is, snap, slot, r, hist_last, hist_since, NULL);
+		for(i = 0; i < n; i++)
+			disp_reading(&r[i]);
+	}
+}
 
+// -F: the new readings of the selected sensors as they are published. Each wakeup takes
+// the readings past the last ones shown from the history rings, so none is missed
+// even if several came at once.
+void follow_readings(struct INSTANCE *is)
+{
+	static oregon_data_t r[OREGON_HISTORY_LEN];
+	struct INSTANCE *snap;
+	unsigned long pos[OREGON_MAX_SENSORS], base[OREGON_MAX_SENSORS];
+	struct timespec wait = { FOLLOW_WAIT_MS / 1000, (FOLLOW_WAIT_MS % 1000) * 1000000L };
+	uint32_t readings;
+	int slot, i, n, pid, first = 1;
+
+	// on the heap - the daemon runs this program too, and locks all of its memory with -T
+	if (!(snap = (struct INSTANCE *)malloc(sizeof(*snap)))) {
+		Msg("Out of memory!");
+		return;
+	}
+	printf("time,id,channel,roll,batt,temp,rssi,lqi\n");
+	fflush(stdout);
+	// with -P the daemon clears pid on exit - kill(0, 0) would test our own process group
+	while ((pid = __atomic_load_n(&is->pid, __ATOMIC_ACQUIRE)) && !(kill(pid, 0) != 0 && errno == ESRCH)) {
+		readings = __atomic_load_n(&is->readings, __ATOMIC_ACQUIRE);
+		shm_snapshot(is, snap, 0);
+		for(slot = 0; slot < OREGON_MAX_SENSORS; slot++) {
+			// the readings before start, or of the sensor that had the slot before, are not shown
+			if (first || snap->sensors[slot].hist_base != base[slot]) {
+				base[slot] = snap->sensors[slot].hist_base;
+				pos[slot] = first ? __atomic_load_n(&is->history[slot].head, __ATOMIC_ACQUIRE) : base[slot];
+			}
+			if (!sensor_match(&snap->sensors[slot], sel_id, sel_chan, sel_roll))
+				continue;
+			n = read_history(is, snap, slot, r, 0, 0, &pos[slot]);
+			for(i = 0; i < n; i++)
+				disp_reading(&r[i]);
+		}
+		first = 0;
+		if (fflush(stdout) != 0)	// the reader went away
+			break;
+		syscall(SYS_futex, &is->readings, FUTEX_WAIT, readings, &wait, NULL, 0);
+	}
+	free(snap);
 }
 
-void do_main_cycle()
+// -q: one query to the daemon's socket - the readings as CSV, the stats as -V shows them
+int show_query()
+{
+	const char *path = query_path ? query_path : OREGON_QUERY_SOCKET;
+	oregon_query_t q;
+
+	memset(&q, 0, sizeof(q));
+	q.version = OREGON_QUERY_VERSION;
+	q.type = query_type;
+	q.id = sel_id;
+	q.channel = sel_chan;
+	q.roll_code = sel_roll;
+	q.last = hist_last;
+	q.since = hist_since;
+	if (query_type != OREGON_Q_STATS)
+		printf("time,id,channel,roll,batt,temp,rssi,lqi\n");
+	if (query_request(path, &q, disp_query_reply, NULL) < 0) {
+		Msg("Query on %s failed (%s)!", path, strerror(errno));
+		return FATALERR;
+	}
+	return SUCCESS;
+}
+
+void disp_query_reply(const oregon_reply_t *rep, const void *recs, void *)
+{
+	const oregon_q_stats_t *st = (const oregon_q_stats_t *)recs;
+	oregon_data_t r;
+	time_t upd;
+	int i;
+
+	if (rep->type != OREGON_Q_STATS) {
+		for(i = 0; i < rep->count; i++) {
+			memcpy(&r, (const oregon_data_t *)recs + i, sizeof(r));
+			disp_reading(&r);
+		}
+		return;
+	}
+	if (!rep->count) {
+		Msg("No sensor matches.");
+		return;
+	}
+	Msg("Bad/Total received Oregon packets:           %llu / %llu", (unsigned long long)(st->total_reads - st->good_reads),
+			(unsigned long long)st->total_reads);
+	if (st->sensor_count != 1) {
+		Msg("Errors: brst1 / brst2 / mburst:              %u / %u / %u", st->brst1_errors, st->brst2_errors, st->mbrst_errors);
+		Msg("Errors: pktlen / bfmatch / chksum:           %u / %u / %u", st->pktlen_errors, st->buffmatch_errors, st->chksum_errors);
+	}
+	Msg("Good packets rebuilt from 2 bad bursts:       %llu", (unsigned long long)st->combined_reads);
+	if (st->min_intvl <= st->max_intvl) {
+		Msg("Min/Max time between good packets [s]:       %u / %u", st->min_intvl, st->max_intvl);
+		Msg("Max T variation between updates [degC]:      %.1f", OREGON_TEMP_C(st->max_temp_diff));
+	}
+	if (st->good_reads > 0) {
+		Msg("Min/Average/Max RSSI (good packets) [dBm]:  %d / %d / %d", st->rssi_min, st->rssi_avg, st->rssi_max);
+		Msg("Max/Average/Min LQI (good packets):          %u / %u / %u", st->lqi_max, st->lqi_avg, st->lqi_min);
+		Msg("RSSI [dBm] p50/p90/p99:                      %d / %d / %d", st->rssi_pct[0], st->rssi_pct[1], st->rssi_pct[2]);
+		Msg("LQI p50/p90/p99:                             %u / %u / %u", st->lqi_pct[0], st->lqi_pct[1], st->lqi_pct[2]);
+		Msg("Interval [s] p50/p90/p99:                    %u / %u / %u", st->intvl_pct[0], st->intvl_pct[1], st->intvl_pct[2]);
+		Msg("Rx to publish latency [us] p50/p90/p99:     %u / %u / %u", st->latency_pct[0], st->latency_pct[1], st->latency_pct[2]);
+	}
+	Msg("Sensors heard:                               %u", st->sensor_count);
+	upd = st->last_upd_time;
+	Msg("Last update:                                 %s", upd ? nol_ctime(&upd) : "never");
+}
+
+void check_query_sum(struct QUERY_CHECK *chk, const oregon_data_t *r, int n)
 {
-	int add_delay, first_iter, buffdiff;
-	uint8_t res1, res2, pktlen, burst_mnum;
-	uint8_t *rx_fifo;
-	unsigned int uDiffTime;
+	int i;
 
-	uPrevTime = uOldTime = millis();
+	for(i = 0; i < n; i++)
+		chk->sum += r[i].time + r[i].sensor_id * 3 + r[i].temp_dc * 5 + r[i].roll_code * 7;
+	chk->recs += n;
+}
+
+void check_query_reply(const oregon_reply_t *rep, const void *recs, void *arg)
+{
+	struct QUERY_CHECK *chk = (struct QUERY_CHECK *)arg;
+
+	if (rep->type == OREGON_Q_STATS)
+		memcpy(&chk->st, recs, rep->count ? sizeof(chk->st) : 0);
+	else
+		check_query_sum(chk, (const oregon_data_t *)recs, rep->count);
+}
+
+// -t -Q: the replies of the test's own query socket against the state - the framing, the
+// stats layout, and the history of every sensor in many packets, which grows the server's
+// reply buffer. The pipeline has ended, so the state no longer changes.
+void check_queries()
+{
+	static oregon_data_t r[OREGON_HISTORY_LEN];
+	struct QUERY_CHECK got[OREGON_Q_HISTORY + 1], want[OREGON_Q_HISTORY + 1];
+	oregon_query_t q;
+	int type, slot;
+
+	memset(got, 0, sizeof(got));
+	memset(want, 0, sizeof(want));
+	memset(&q, 0, sizeof(q));
+	q.version = OREGON_QUERY_VERSION;
+	q.id = q.channel = q.roll_code = OREGON_Q_ANY;
+	for(type = OREGON_Q_LATEST; type <= OREGON_Q_HISTORY; type++) {
+		q.type = type;
+		if (query_request(query_path, &q, check_query_reply, &got[type]) < 0) {
+			Msg("Query socket: %s query failed (%s)!", (type == OREGON_Q_LATEST) ? "latest" :
+					(type == OREGON_Q_STATS) ? "stats" : "history", strerror(errno));
+			query_failed = 1;
+			return;
+		}
+	}
+	for(slot = 0; slot < OREGON_MAX_SENSORS; slot++) {
+		if (!sensor_match(&my_instance->sensors[slot], OREGON_Q_ANY, OREGON_Q_ANY, OREGON_Q_ANY))
+			continue;
+		check_query_sum(&want[OREGON_Q_LATEST], &my_instance->sensors[slot].oregon_data, 1);
+		check_query_sum(&want[OREGON_Q_HISTORY], r, read_history(my_instance, my_instance, slot, r, 0, 0, NULL));
+	}
+	Msg("Query socket latest / history records:       %ld / %ld", got[OREGON_Q_LATEST].recs, got[OREGON_Q_HISTORY].recs);
+	if (got[OREGON_Q_LATEST].recs != want[OREGON_Q_LATEST].recs || got[OREGON_Q_LATEST].sum != want[OREGON_Q_LATEST].sum ||
+			got[OREGON_Q_HISTORY].recs != want[OREGON_Q_HISTORY].recs || got[OREGON_Q_HISTORY].sum != want[OREGON_Q_HISTORY].sum ||
+			got[OREGON_Q_STATS].st.total_reads != my_instance->total_reads ||
+			got[OREGON_Q_STATS].st.good_reads != my_instance->good_reads ||
+			got[OREGON_Q_STATS].st.combined_reads != my_instance->combined_reads ||
+			got[OREGON_Q_STATS].st.chksum_errors != my_instance->chksum_errors ||
+			got[OREGON_Q_STATS].st.sensor_count != (uint32_t)my_instance->sensor_count) {
+		Msg("Query socket: expected %ld / %ld records, stats of %lu packets - got stats of %llu!",
+				want[OREGON_Q_LATEST].recs, want[OREGON_Q_HISTORY].recs, my_instance->total_reads,
+				(unsigned long long)got[OREGON_Q_STATS].st.total_reads);
+		query_failed = 1;
+	}
+}
+
+//-----------------------[round-robin archive]----------------------------------
+
+// -R: straight from the mapped file, the daemon need not run
+void archive_dump()
+{
+	static oregon_data_t raw[OREGON_AR_RAW_LEN];
+	static oregon_ar_row_t rows[OREGON_AR_HOUR_LEN];
+	const char *path = archive_path ? archive_path : OREGON_ARCHIVE_FILE;
+	oregon_archive_t *ar;
+	struct stat sb;
+	uint32_t i, n;
+	int fd, slot;
+
+	if ((fd = open(path, O_RDONLY)) == -1 || fstat(fd, &sb) != 0) {
+		Msg("Cannot open archive %s (%s).", path, strerror(errno));
+		exit(1);
+	}
+	ar = (oregon_archive_t *)mmap(NULL, MAX((size_t)sb.st_size, sizeof(oregon_archive_t)), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ar == MAP_FAILED || !oregon_archive_valid(ar, sb.st_size)) {
+		Msg("%s is not an archive of this version.", path);
+		exit(1);
+	}
+	if (archive_tier == OREGON_AR_RAW)
+		printf("time,id,channel,roll,batt,temp,rssi,lqi\n");
+	else
+		printf("time,id,channel,min,avg,max,count\n");
+	for(slot = oregon_archive_find(ar, sel_id, sel_chan, 0); slot >= 0; slot = oregon_archive_find(ar, sel_id, sel_chan, slot + 1)) {
+		if (archive_tier == OREGON_AR_RAW) {
+			n = oregon_archive_read(ar, slot, archive_tier, archive_from, archive_to, raw, OREGON_AR_RAW_LEN);
+			for(i = 0; i < n; i++)
+				disp_reading(&raw[i]);
+			continue;
+		}
+		n = oregon_archive_read(ar, slot, archive_tier, archive_from, archive_to, rows, OREGON_AR_HOUR_LEN);
+		for(i = 0; i < n; i++)
+			printf("%u,0x%04X,%u,%.1f,%.1f,%.1f,%u\n", rows[i].time, ar->sensors[slot].sensor_id, ar->sensors[slot].channel,
+					OREGON_TEMP_C(rows[i].min_dc), OREGON_TEMP_C((double)rows[i].sum_dc / rows[i].count),
+					OREGON_TEMP_C(rows[i].max_dc), rows[i].count);
+	}
+	munmap(ar, MAX((size_t)sb.st_size, sizeof(oregon_archive_t)));
+}
+//-------------------------------[end]------------------------------------------
+
+
+void do_main_cycle()
+{
+	int add_delay, got_packet, pipeline;
+	unsigned int uRxTime, uOldTime, uDiffTime, uArmTime;
+	uint32_t sleep_ms, listen_ms = EVENT_WAIT_MS;
+	uint64_t rx_ns;
+	struct timespec wall_start, wall_end;
+	double wall_s;
+
+	clock_gettime(CLOCK_MONOTONIC, &wall_start);
+	uOldTime = transport->millis();
+	if (state_resumed)
+		resume_state(my_instance);
 	add_delay = ADDITIONAL_DELAY_MS;
-	first_iter = 1;
-	burst_mnum = 0;
 
+	if (event_mode && !cc1101_oregon.packet_events_begin()) {
+		Msg("GDO2 events not available (%s line %d) - polling instead.", GDO2_GPIOCHIP, GDO2_LINE);
+		event_mode = 0;
+	}
 	if (test_mode)
 		Msg("");
-
-	// main loop
-	while (keep_running) {
-		delay(SHORT_DELAY_MS+add_delay);                            //delay to reduce system load
-		if (cc1101_oregon.packet_available())		 //checks if a packet is available
+	capture_begin();
+	query_begin();
+	archive_begin();
+	log_begin(sim_sensors);
+	pipeline = pipeline_begin();
+	if (pipeline)
+		realtime_begin();
+	if (sched_rx || wor_rx)
+		oregon_sched_init(&rx_sched, transport->millis());
+	radio_account(RADIO_RX);
+	uArmTime = transport->millis();
+
+	// main loop - the radio thread
+	while (pipeline && keep_running && !transport->exhausted()) {
+		radio_account(radio_mode);
+		__atomic_store_n(&radio_wakeups, radio_wakeups + 1, __ATOMIC_RELAXED);
+		if (sched_rx && (sleep_ms = oregon_sched_next(&rx_sched, transport->millis(), &listen_ms)) > 0) {
+			radio_sleep(sleep_ms);
+			continue;
+		}
+		if (wor_rx) {
+			radio_wor(wor_repeat_ms && !oregon_sched_learning(&rx_sched, transport->millis()));
+			if (radio_mode == RADIO_WOR && transport->millis() - uArmTime >= WOR_REARM_MS) {
+				cc1101_oregon.wor_reset();
+				uArmTime = transport->millis();
+			}
+		}
+		if (event_mode)
+			got_packet = cc1101_oregon.wait_packet(MIN(listen_ms, EVENT_WAIT_MS));       //sleeps until end of packet
+		else {
+			transport->delay_ms(SHORT_DELAY_MS+add_delay);                            //delay to reduce system load
+			got_packet = cc1101_oregon.packet_available();		 //checks if a packet is available
+		}
+		if (got_packet)
 		{
-		  uCurrTime = millis();
-		  if (uCurrTime < uOldTime)
-			  uDiffTime = uCurrTime + ~uOldTime + 1;
+		  // the GDO2 edge (a kernel timestamp on the radio) or the detection, on the transport clock
+		  rx_ns = event_mode ? cc1101_oregon.last_event_ns : transport->nanos();
+		  uRxTime = transport->millis();
+		  if (uRxTime < uOldTime)
+			  uDiffTime = uRxTime + ~uOldTime + 1;
 		  else
-			  uDiffTime = uCurrTime - uOldTime;
+			  uDiffTime = uRxTime - uOldTime;
+		  // polling: fast after a burst that starts a quiet period, as its repeat follows
+		  // shortly - which burst belongs to which message is up to the decode thread
 		  if ( uDiffTime > MSG_TIMEOUT_MS )
 		  {
-			  uOldTime = uCurrTime;
+			  uOldTime = uRxTime;
 			  add_delay = 0;
-			  burst_mnum = 0;
-		  } else {
+		  } else
 			  add_delay = ADDITIONAL_DELAY_MS;
-			  my_instance->total_reads++;
-			  burst_mnum++;
-		  }
 
-		  if ((burst_mnum != 1) || first_iter) {
-			  // get first message of a burst into the first rx buffer
-			  // or get any 3rd and + spurious message of a burst, just to clear cc1101 buffer
-			  res1 = cc1101_oregon.get_oregon_raw(rx_fifo1, pktlen1, rssi_dbm1, lqi1);
-			  if (burst_mnum > 1)
-				  my_instance->mbrst_errors++;
-		  } else {
-			  // receive the second message of a burst into the second rx buffer
-			  res2 = cc1101_oregon.get_oregon_raw(rx_fifo2, pktlen2, rssi_dbm2, lqi2);
-			  if (test_mode)
-				  Msg("Rx @ %ld.%d s:", uCurrTime/1000,uCurrTime % 1000);
-			  if (debug_level > 1)
-				  Msg("res1 %d  res2 %d  pktlen1 %u  pktlen2 %u", res1, res2, pktlen1, pktlen2);
-			  // pre-set checksum flag for the counters
-			  my_instance->oregon_data.cksum_ok = 1;
-			  // sometimes decoded data can span a bit longer - cap the pktlen in case 2 bursts are OK
-			  // else just take the pktlen of the good burst, and 0 if both bursts are bad
-			  if (res1 && res2) {
-				  pktlen = MIN(pktlen1, pktlen2);
-				  rx_fifo = rx_fifo2;
-				  buffdiff = memcmp(rx_fifo1, rx_fifo2, MIN(pktlen, THN122N_PKTLEN_USED_DECODE)); // Note: compare only decoded part
-			  }
-			  else {
-				  pktlen = ((res1)?pktlen1:pktlen2);
-#if !PARANOID_NEEDS_BOTH_MESSAGES
-				  rssi_dbm1 = rssi_dbm2 = ((res1)?rssi_dbm1:rssi_dbm2);
-				  lqi1 = lqi2 = ((res1)?lqi1:lqi2);
-				  rx_fifo = ((res1)?rx_fifo1:rx_fifo2);
-#endif
-				  buffdiff = 0;
-			  }
-
-#if PARANOID_NEEDS_BOTH_MESSAGES
-			  // check if both Rx bursts are ok, if bursts are sufficiently long, and compare the two buffers
-			  if (res1 && res2 && (pktlen >= THN122N_MIN_PKTLEN_FOR_DECODE) && !buffdiff &&
-#else
-			  // check if at least one Rx burst is ok, and if that burst is sufficiently long
-			  if ((res1 || res2) && (pktlen >= THN122N_MIN_PKTLEN_FOR_DECODE) &&
-#endif
-					  cc1101_oregon.get_oregon_data(rx_fifo, pktlen, &(my_instance->oregon_data)) && my_instance->oregon_data.cksum_ok)
-			  {
-				  my_instance->good_reads++;
-				  my_instance->oregon_data.rssi_dbm = MIN(rssi_dbm1, rssi_dbm2);
-				  my_instance->oregon_data.lqi = MAX(lqi1, lqi2);
-				  update_global_stats(my_instance);
-				  if (debug_level) {
-					  Msg("=== Rx stats ====");
-					  disp_rx_stats(my_instance);
-				  } else {
-					  if (test_mode && ((my_instance->total_reads % SKIP_LOG_COUNT) == 1))
-						  Msg("Oregon pkt (bad/all) # %lu / %lu ", my_instance->total_reads - my_instance->good_reads, my_instance->total_reads);
-				  }
-				  my_instance->last_upd_time = time(NULL);
-				  if (test_mode) {
-					  if (debug_level) {
-						 Msg("=== Decoded packet ==");
-					  }
-					  disp_oregon_data(my_instance, 0);
-				  }
-			  }
-			  if (!res1)
-				  my_instance->brst1_errors++;
-			  if (!res2)
-				  my_instance->brst2_errors++;
-			  if (pktlen < THN122N_MIN_PKTLEN_FOR_DECODE)
-				  my_instance->pktlen_errors++;
-			  if (buffdiff)
-				  my_instance->buffmatch_errors++;
-			  if (!my_instance->oregon_data.cksum_ok)
-				  my_instance->chksum_errors++;
-			  if (test_mode)
-				Msg("");
+		  rx_burst(uRxTime, rx_ns);
+		  if (radio_mode == RADIO_WOR) {	// the radio is back in RX after the FIFO read
+			  cc1101_oregon.wor_reset();
+			  uArmTime = uRxTime;
 		  }
-		  first_iter = 0;
-		}
-		if (clear_stats && add_delay) { // reset statistics has been requested
-			clear_stats = 0;
-			init_inst_struct(my_instance, 0);
-			Msg("Oregon Rx statistics was reset!");
 		}
 	}
+	radio_account(radio_mode);
+	if (pipeline)
+		pipeline_end();
+	log_end();
+	if (test_mode && query_path)
+		check_queries();
+	query_end();
+	archive_end();
+	capture_end();
 	if (test_mode) {
 		Msg("\n=== Oregon Rx statistics ===");
 		disp_rx_stats(my_instance);
+		disp_sensors(my_instance);
 		Msg("");
+		if (test_history)
+			disp_history(my_instance, my_instance);
+		if (sim_sensors) {
+			clock_gettime(CLOCK_MONOTONIC, &wall_end);
+			wall_s = (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+			Msg("Sim wall time [s]: %.3f  (%.0f packets/s)", wall_s,
+					(wall_s > 0) ? my_instance->total_reads / wall_s : 0.0);
+		}
 	}
 }
 
@@ -383,8 +672,13 @@ void process_options(int argc, char *argv[])
 	extern  int     optind, opterr;
 	extern  char    *optarg;
 	int     c, have_args = 0;
+	char	*p;
+	static struct option long_opts[] = {
+		{ "follow", no_argument, NULL, 'F' },
+		{ NULL, 0, NULL, 0 }
+	};
 
-	while ((c = getopt(argc, argv, OPTCHARS)) != EOF)	{
+	while ((c = getopt_long(argc, argv, OPTCHARS, long_opts, NULL)) != EOF)	{
 		switch (c) {
 		case 'd':
 			if (optarg != NULL)
@@ -423,6 +717,110 @@ void process_options(int argc, char *argv[])
 			test_mode = 1;
 			have_args |= ARG_t;
 			break;
+		case 'S':
+			if (optarg != NULL) {
+				sim_sensors = MIN(MAX(atoi(optarg),1), SIM_MAX_SENSORS);
+				if (strchr(optarg, ','))
+					sim_transport.set_bit_errors(atoi(strchr(optarg, ',') + 1));
+			} else
+				sim_sensors = 1;
+			have_args |= ARG_S;
+			break;
+		case 'E':
+			event_mode = 1;
+			have_args |= ARG_E;
+			break;
+		case 'C':
+			capture_path = optarg;
+			have_args |= ARG_C;
+			break;
+		case 'i':
+			sel_id = strtol(optarg, &p, 16);
+			if (*p == ',')
+				sel_chan = strtol(p + 1, &p, 10);
+			if (*p == ',')
+				sel_roll = strtol(p + 1, &p, 16);
+			if (*p || sel_id < 0 || sel_id > 0xffff) {
+				Msg("Error! -i expects a sensor ID in hex, optionally followed by ,channel and ,roll code (hex).");
+				exit(1);
+			}
+			have_args |= ARG_i;
+			break;
+		case 'H':
+			if (optarg[0] == '@')
+				hist_since = strtol(optarg + 1, &p, 10);
+			else
+				hist_last = strtol(optarg, &p, 10);
+			if (*p || hist_since < 0 || hist_last < 0) {
+				Msg("Error! -H expects a number of readings or @seconds since epoch.");
+				exit(1);
+			}
+			show_history = 1;
+			have_args |= ARG_H;
+			break;
+		case 'P':
+			state_path = (optarg != NULL) ? optarg : (char *)OREGON_STATE_FILE;
+			have_args |= ARG_P;
+			break;
+		case 'F':
+			follow = 1;
+			have_args |= ARG_F;
+			break;
+		case 'A':
+			archive_path = (optarg != NULL) ? optarg : (char *)OREGON_ARCHIVE_FILE;
+			have_args |= ARG_A;
+			break;
+		case 'R':
+			archive_tier = !strncmp(optarg, "raw", 3) ? OREGON_AR_RAW : !strncmp(optarg, "5m", 2) ? OREGON_AR_5MIN :
+					!strncmp(optarg, "1h", 2) ? OREGON_AR_HOUR : -1;
+			p = optarg + strcspn(optarg, ",");
+			if (*p == ',')
+				archive_from = strtoul(p + 1, &p, 10);
+			if (*p == ',')
+				archive_to = strtoul(p + 1, &p, 10);
+			if (*p || archive_tier < 0 || strcspn(optarg, ",") != (archive_tier ? 2U : 3U)) {
+				Msg("Error! -R expects raw, 5m or 1h, optionally followed by ,from and ,to (seconds since epoch).");
+				exit(1);
+			}
+			have_args |= ARG_R;
+			break;
+		case 'M':
+			metrics_addr = optarg;
+			have_args |= ARG_M;
+			break;
+		case 'Q':
+			query_path = (optarg != NULL) ? optarg : (char *)OREGON_QUERY_SOCKET;
+			have_args |= ARG_Q;
+			break;
+		case 'q':
+			query_type = !strcmp(optarg, "latest") ? OREGON_Q_LATEST : !strcmp(optarg, "stats") ? OREGON_Q_STATS :
+					!strcmp(optarg, "history") ? OREGON_Q_HISTORY : 0;
+			if (!query_type) {
+				Msg("Error! -q expects latest, stats or history.");
+				exit(1);
+			}
+			have_args |= ARG_q;
+			break;
+		case 'T':
+			rt_prio = strtol(optarg, &p, 10);
+			if (*p == ',')
+				rt_cpu = strtol(p + 1, &p, 10);
+			if (*p || rt_prio < sched_get_priority_min(SCHED_FIFO) || rt_prio > sched_get_priority_max(SCHED_FIFO) ||
+					rt_cpu >= CPU_SETSIZE) {
+				Msg("Error! -T expects a SCHED_FIFO priority (%d..%d), optionally followed by ,cpu.",
+						sched_get_priority_min(SCHED_FIFO), sched_get_priority_max(SCHED_FIFO));
+				exit(1);
+			}
+			have_args |= ARG_T;
+			break;
+		case 's':
+			sched_rx = 1;
+			have_args |= ARG_s;
+			break;
+		case 'w':
+			wor_rx = 1;
+			have_args |= ARG_w;
+			break;
 		case 'n':
 			data_invalid_timeout = MAX(atoi(optarg),OREGON_DATA_MIN_TIMEOUT_S);
 			have_args |= ARG_n;
@@ -432,18 +830,63 @@ void process_options(int argc, char *argv[])
 			exit(0);
 		}
 	}
+	if ((have_args & ARG_i) && !(show_data || bare_temp || show_verbose || show_history || follow || query_type || archive_tier >= 0)){
+	    Msg("Error! -i option can be used only with -o, -b, -V, -H, -F, -q or -R.");
+	    exit(1);
+	}
+	// -i, -P and -A only refine the other options
+	have_args &= ~(ARG_i | ARG_P | ARG_A);
+	// -Q names the socket, -H the history range
+	if (query_type && ((have_args & ~(ARG_Q | ARG_H)) != ARG_q || (show_history && query_type != OREGON_Q_HISTORY))){
+	    Msg("Error! -q option can be used only alone, with -Q file, -i or (history) -H.");
+	    exit(1);
+	}
+	if (query_type)
+		show_history = 0;
+	if (archive_tier >= 0 && (have_args != ARG_R)){
+	    Msg("Error! -R option can be used only alone, with -i or with -A.");
+	    exit(1);
+	}
 	if (bare_temp && (have_args != ARG_b)){
 	    Msg("Error! -b option can't be used with any other options.");
 	    exit(1);
 	}
+	if (follow && (have_args != ARG_F)){
+	    Msg("Error! -F option can be used only alone or with -i.");
+	    exit(1);
+	}
 	if (show_data && (have_args != ARG_o)){
 	    Msg("Error! -o option can't be used with any other options.");
 	    exit(1);
 	}
-	if (test_mode && (have_args != ARG_t)){
+	if (show_history && ((have_args & ~(test_mode ? ARG_t | ARG_S | ARG_E | ARG_C | ARG_Q | ARG_M | ARG_T | ARG_s | ARG_w : 0)) != ARG_H)){
+	    Msg("Error! -H option can be used only alone, with -i or with -t (dump at the end).");
+	    exit(1);
+	}
+	if (test_mode && show_history) {
+		test_history = 1;
+		show_history = 0;
+		have_args &= ~ARG_H;
+	}
+	if (test_mode && ((have_args & ~(ARG_S | ARG_E | ARG_C | ARG_Q | ARG_M | ARG_T | ARG_s | ARG_w)) != ARG_t)){
 	    Msg("Error! -t option can't be used with any other options.");
 	    exit(1);
 	}
+	// polling reads the chip over SPI, which would wake it up from WOR
+	if (wor_rx && !event_mode) {
+	    Msg("Error! -w option can be used only with -E option");
+	    exit(1);
+	}
+	if (sim_sensors && !test_mode) {
+	    Msg("Error! -S option can be used only with -t option");
+	    exit(1);
+	}
+#if CC1101_NO_WIRINGPI
+	if (!sim_sensors && !(show_verbose || bare_temp || show_data || show_history || follow || query_type || archive_tier >= 0 || kill_proc || reset_stats)) {
+	    Msg("Error! Built without wiringPi - only -t -S (simulated radio) can run the receiver.");
+	    exit(1);
+	}
+#endif
 	if (debug_level > 0 && !test_mode) {
 	    Msg("Error! -d option can be used only with -t option");
 	    exit(1);
@@ -508,84 +951,22 @@ void dump_shm(struct shmid_ds *d)
 }
 #endif
 
-void disp_rx_stats(struct INSTANCE *is)
-{
-	Msg("Bad/Total received Oregon packets:           %lu / %lu", is->total_reads - is->good_reads, is->total_reads);
-//	if (is->good_reads < is->total_reads)
-	Msg("Errors: brst1 / brst2 / mburst:              %u / %u / %u", is->brst1_errors, is->brst2_errors, is->mbrst_errors);
-	Msg("Errors: pktlen / bfmatch / chksum:           %u / %u / %u", is->pktlen_errors, is->buffmatch_errors, is->chksum_errors);
-	if (is->good_reads > 1) {
-		Msg("Min/Max time between good packets [s]:       %u / %u", is->min_intvl, is->max_intvl);
-		Msg("Max T variation between updates [degC]:      %.1f", is->max_temp_diff);
-	}
-	if (is->good_reads > 0) {
-		if (is->rssi_max >= is->rssi_min)
-			Msg("Min/Average/Max RSSI (good packets) [dBm]:  %d / %ld / %d", is->rssi_min, is->rssi_sum / (long)is->good_reads, is->rssi_max);
-		if (is->lqi_max >= is->lqi_min)
-			Msg("Max/Average/Min LQI (good packets):          %u / %lu / %u", is->lqi_max, is->lqi_sum / is->good_reads, is->lqi_min);
-	}
-}
-
-
-void disp_oregon_data(struct INSTANCE *is, int disp_time)
-{
-	if (disp_time)
-		Msg("Time received: %s (%d sec. ago)", nol_ctime(&(is->last_upd_time)), time(NULL)-is->last_upd_time);
-	Msg("RSSI min [dBm]: %d  LQI max: %d", is->oregon_data.rssi_dbm, is->oregon_data.lqi);
-	Msg("sensor ID: 0x%04X", is->oregon_data.sensor_id);
-	Msg("sensor chan: %d", is->oregon_data.channel);
-	Msg("roll code: 0x%02X", is->oregon_data.roll_code);
-	Msg("batt_low: %d", is->oregon_data.batt_low);
-	Msg("cksum_ok: %d", is->oregon_data.cksum_ok);
-//	Msg("Time received: %s", ctime(&(is->last_upd_time)));
-	Msg("temperature [degC]: %.1f", is->oregon_data.temperature);
-
-}
-
-void init_inst_struct(struct INSTANCE *is, int clear_all)
-{
-	if (clear_all)
-		memset((char *) is, 0, sizeof(is));
-	else {
-		if (is->reset_flags == 0xff) {
-			is->total_reads = 0;
-			is->rssi_sum = 0;
-			is->lqi_sum = 0;
-		}
-		if (is->reset_flags & 0x1) {
-			is->good_reads = is->total_reads;
-			is->brst1_errors = 0;
-			is->brst2_errors = 0;
-			is->mbrst_errors = 0;
-			is->pktlen_errors = 0;
-			is->buffmatch_errors = 0;
-			is->chksum_errors = 0;
-			is->reset_flags |= 0x4 | 0x8;
-		}
-		if (is->reset_flags & 0x2)
-			is->max_intvl = 0;
-		if (is->reset_flags & 0x8)
-			is->lqi_max = 0;
-		if (is->reset_flags & 0x10)
-			is->max_temp_diff = 0;
-	}
-	if ((is->reset_flags & 0x2) || clear_all)
-		is->min_intvl = 0xffff;
-	if ((is->reset_flags & 0x8) || clear_all)
-		is->lqi_min = 127;
-	if ((is->reset_flags & 0x4) || clear_all) {
-		is->rssi_max = -128;
-		is->rssi_min = 127;
-	}
-	is->reset_flags = 0xff;
-}
 
 void init_HW()
 {
 	//------------- hardware setup ------------------------
 
-	wiringPiSetup();			//setup wiringPi library
+	if (sim_sensors) {
+		sim_transport.add_thn122n_sensors(sim_sensors);
+		transport = &sim_transport;
+	}
+#if !CC1101_NO_WIRINGPI
+	else
+		transport = &wiringpi_transport;
+#endif
+	transport->setup();			//setup wiringPi library (or the simulated radio)
 
+	cc1101_oregon.set_transport(transport);
 	cc1101_oregon.begin(debug_level);			//setup cc1101 RF IC
 	cc1101_oregon.sidle();
 
@@ -603,6 +984,8 @@ int get_shm_info()
 	int	flag;
 	struct	shmid_ds ds;
 
+	if (state_path)
+		return get_state_file();
 	flag = IPC_CREAT | 0666;
 	if ((shmid = shmget(OREAD_KEY, SHMEM_SIZE, flag)) == -1) {
 	    Msg("Cannot get shared memory (%s). Ending!", strerror(errno));
@@ -632,6 +1015,80 @@ int get_shm_info()
 	my_instance->data_invalid_timeout = data_invalid_timeout;
 	return SUCCESS;
 }
+/////////////////////////////////////////////////////////////////////////
+int get_state_file()
+{
+	int	fd;
+
+	if (!strcmp(state_path, OREGON_STATE_FILE))
+		mkdir(OREGON_STATE_DIR, 0755);
+	if ((fd = open(state_path, O_RDWR | O_CREAT, 0644)) == -1) {
+	    Msg("Cannot open state file %s (%s). Ending!", state_path, strerror(errno));
+	    return FATALERR;
+	}
+	// held until exit - also tells a second daemon that one is running
+	if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+	    Msg("One %s process is already active.", program);
+	    close(fd);
+	    return FATALERR;
+	}
+	if (ftruncate(fd, sizeof(struct STATE_FILE)) != 0) {
+	    Msg("Cannot size state file %s (%s). Ending!", state_path, strerror(errno));
+	    close(fd);
+	    return FATALERR;
+	}
+	state_map = (struct STATE_FILE *)mmap(NULL, sizeof(struct STATE_FILE), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (state_map == MAP_FAILED) {
+	    Msg("Cannot map state file %s (%s). Ending!", state_path, strerror(errno));
+	    state_map = NULL;
+	    close(fd);
+	    return FATALERR;
+	}
+	my_instance = &state_map->inst;
+	if (state_map->magic == STATE_MAGIC && state_map->version == STATE_VERSION &&
+			state_map->header_size == offsetof(struct STATE_FILE, inst) &&
+			state_map->state_size == sizeof(struct INSTANCE)) {
+		state_resumed = 1;
+		if (my_instance->seq & 1)	// the last daemon died while publishing
+			my_instance->seq++;
+		Msg("State resumed from %s (%lu packets, %u sensors).", state_path,
+				my_instance->total_reads, my_instance->sensor_count);
+	} else {
+		memset(state_map, 0, sizeof(struct STATE_FILE));
+		init_inst_struct(my_instance, 1);
+		state_map->magic = STATE_MAGIC;
+		state_map->version = STATE_VERSION;
+		state_map->header_size = offsetof(struct STATE_FILE, inst);
+		state_map->state_size = sizeof(struct INSTANCE);
+	}
+	my_instance->pid = getpid();
+	my_instance->data_invalid_timeout = data_invalid_timeout;
+	return SUCCESS;
+}
+
+// the receive times in ms are of the previous process - move them to the current
+// clock, by how long ago the last readings were received
+void resume_state(struct INSTANCE *is)
+{
+	time_t now = time(NULL);
+	unsigned int now_ms = transport->millis();
+	int i;
+
+	for(i = 0; i < OREGON_MAX_SENSORS; i++)
+		if (is->sensors[i].used)
+			is->sensors[i].last_rx_ms = now_ms - (now - is->sensors[i].oregon_data.time) * 1000;
+}
+
+// the file stays, clients see that no daemon is running by the PID
+void release_state()
+{
+	my_instance->pid = 0;
+	msync(state_map, sizeof(struct STATE_FILE), MS_SYNC);
+	munmap(state_map, sizeof(struct STATE_FILE));
+	state_map = NULL;
+	my_instance = NULL;
+}
+
 /////////////////////////////////////////////////////////////////////////
 int run_as_background()
 {
@@ -659,6 +1116,8 @@ int run_as_background()
 			syslog(LOG_INFO, "v%s daemon started\n",VERSION_SW);
 			do_main_cycle();
 			cc1101_oregon.end();
+			if (state_path)
+				release_state();
 			syslog(LOG_INFO, "v%s daemon ended.\n", VERSION_SW);
 			break;
 	}
@@ -669,14 +1128,14 @@ int run_as_background()
 void interact_with_daemon()
 {
 	int	i;
-	int	flag, cfg_found=0;
+	int	cfg_found=0;
 	struct	INSTANCE *is;
-	time_t curr_time;
+	struct	INSTANCE *snap = NULL;
+	struct	SENSOR *s = NULL;
+	oregon_data_t *od;
+	time_t curr_time, upd_time;
 
-	if ((shmid = shmget(OREAD_KEY, SHMEM_SIZE, 0)) != -1) {
-	    flag = ((kill_proc || reset_stats) ? 0 : SHM_RDONLY);
-	    if ((shmaddr = shmat(shmid, 0, flag)) != (void *)-1) {
-		    is = (struct INSTANCE *)shmaddr;
+	if ((is = attach_daemon(kill_proc || reset_stats)) != NULL) {
 		    if (is->pid) {
 				if (kill_proc) {
 					if (kill(is->pid, SIGTERM) != 0) {
@@ -685,32 +1144,70 @@ void interact_with_daemon()
 						} else {
 							Msg("Can't terminate process %d (%s)!",
 									is->pid, strerror(errno));
-							shmdt(shmaddr);
+							detach_daemon();
 							return;
 						}
 					} else
 						Msg("Process %d terminated.",  is->pid);
+					if (state_map) {	// the daemon keeps its state file
+						detach_daemon();
+						return;
+					}
 					shmdt(shmaddr);
 					if (shmctl(shmid, IPC_RMID, NULL) != 0) {
 					    Msg("Cannot remove shared memory (%s)!", strerror(errno));
 					}
 					return;
 				}
+				if (follow) {
+					follow_readings(is);
+					detach_daemon();
+					return;
+				}
 				curr_time  =  time(NULL);
+				// on the heap - the daemon runs this program too, and locks all of its memory with -T
+				if (!(snap = (struct INSTANCE *)malloc(sizeof(*snap)))) {
+					Msg("Out of memory!");
+					detach_daemon();
+					return;
+				}
+				if (show_history) {
+					shm_snapshot(is, snap, 0);
+					disp_history(is, snap);
+				}
+				if (show_verbose || show_data || bare_temp) {
+					shm_snapshot(is, snap, show_verbose);
+					is = snap;
+				}
+				od = &is->oregon_data;
+				upd_time = is->last_upd_time;
+				if (sel_id >= 0) {
+					s = find_sensor(is, sel_id, sel_chan, sel_roll);
+					if (s) {
+						od = &s->oregon_data;
+						upd_time = s->oregon_data.time;
+					} else
+						upd_time = 0;
+				}
 				if (show_verbose)
 				{
 					Msg("\nDaemon process active: %d",
 						is->pid);
 					Msg("Timeout for Oregon data to be claimed invalid: %d s", is->data_invalid_timeout);
 					Msg("");
-					if (is->last_upd_time > 0) {
-						if (is->good_reads > 0) {
-							Msg("=== Rx stats ====");
-							disp_rx_stats(is);
+					if (upd_time > 0) {
+						if (sel_id >= 0)
+							disp_sensor(s, &is->sensor_hists[s - is->sensors], 1);
+						else {
+							if (is->good_reads > 0) {
+								Msg("=== Rx stats ====");
+								disp_rx_stats(is);
+								disp_sensors(is);
+							}
+							Msg("=== Last update ==");
+							disp_oregon_data(od, upd_time, 1);
 						}
-						Msg("=== Last update ==");
-						disp_oregon_data(is, 1);
-						if (curr_time - is->last_upd_time >= is->data_invalid_timeout)
+						if (curr_time - upd_time >= is->data_invalid_timeout)
 							Msg("Warning: The update is too old!");
 					}
 					else
@@ -719,20 +1216,22 @@ void interact_with_daemon()
 				if (show_data || bare_temp)
 				{
 					if (show_data) {
-						if (is->last_upd_time > 0) {
-							printf("Last update: %s (%d sec. ago)\n", nol_ctime(&(is->last_upd_time)), curr_time-is->last_upd_time);
-							printf("Outdoor temperature [degC]: %.1f\n", is->oregon_data.temperature);
+						if (upd_time > 0) {
+							printf("Last update: %s (%d sec. ago)\n", nol_ctime(&upd_time), curr_time-upd_time);
+							if (sel_id >= 0)
+								printf("Sensor 0x%04X ch %d roll 0x%02X\n", od->sensor_id, od->channel, od->roll_code);
+							printf("Outdoor temperature [degC]: %.1f\n", OREGON_TEMP_C(od->temp_dc));
 						} else
 							printf("No data yet!\n");
 					}
-					if (curr_time - is->last_upd_time < is->data_invalid_timeout) {
+					if (curr_time - upd_time < is->data_invalid_timeout) {
 						if (bare_temp)
-							printf("%.1f\n", is->oregon_data.temperature);
+							printf("%.1f\n", OREGON_TEMP_C(od->temp_dc));
 					} else {
 						if (bare_temp)
 							printf("U\n"); // for an RRD database - unknown value
 						else {
-							if (is->last_upd_time > 0)
+							if (upd_time > 0)
 								printf("Invalid reading (last update too old)!\n");
 						}
 					}
@@ -746,9 +1245,9 @@ void interact_with_daemon()
 				}
 		    } else
 		    	Msg("Error in shared memory data - daemon PID is 0!");
-			shmdt(shmaddr);
+			free(snap);
+			detach_daemon();
 			return;
-	    }
     }
     Msg("No %s processes active.", program);
     if (kill_proc) {
@@ -756,24 +1255,44 @@ void interact_with_daemon()
     }
 }
 
-char   *nol_ctime(const time_t *timep)
+// the SysV segment of a daemon, else the state file of a daemon started with -P
+struct INSTANCE *attach_daemon(int writable)
 {
-	struct tm *ptm = localtime(timep);
-	strftime(strbuf, LINELEN, "%c", ptm);
-	return strbuf;
+	struct STATE_FILE *sf;
+	struct stat sb;
+	int fd;
+
+	if ((shmid = shmget(OREAD_KEY, SHMEM_SIZE, 0)) != -1) {
+	    if ((shmaddr = shmat(shmid, 0, writable ? 0 : SHM_RDONLY)) != (void *)-1)
+	    	return (struct INSTANCE *)shmaddr;
+	    return NULL;
+	}
+	if ((fd = open(state_path ? state_path : OREGON_STATE_FILE, writable ? O_RDWR : O_RDONLY)) == -1)
+		return NULL;
+	if (fstat(fd, &sb) != 0 || sb.st_size < (off_t)sizeof(struct STATE_FILE)) {
+		close(fd);
+		return NULL;
+	}
+	sf = (struct STATE_FILE *)mmap(NULL, sizeof(struct STATE_FILE), PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED, fd, 0);
+	close(fd);
+	if (sf == MAP_FAILED)
+		return NULL;
+	if (sf->magic != STATE_MAGIC || sf->version != STATE_VERSION || sf->state_size != sizeof(struct INSTANCE) ||
+			!sf->inst.pid || (kill(sf->inst.pid, 0) != 0 && errno == ESRCH)) {
+		munmap(sf, sizeof(struct STATE_FILE));
+		return NULL;
+	}
+	state_map = sf;
+	return &sf->inst;
 }
 
-/////////////////////////////////////////////////////////////////////////////
-void Msg(const char *fmt, ...)
+void detach_daemon()
 {
-	va_list ap;
-	char	errmsg[LINELEN];
-
-	va_start(ap, fmt);
-	vsnprintf(errmsg, LINELEN-1, fmt, ap);
-	va_end(ap);
-	if (log2syslog > 0)
-		syslog(LOG_ERR, "%s\n", errmsg);
-	else
-		fprintf(stderr, "%s\n", errmsg);
+	if (state_map) {
+		munmap(state_map, sizeof(struct STATE_FILE));
+		state_map = NULL;
+	} else
+		shmdt(shmaddr);
 }
+
+/////////////////////////////////////////////////////////////////////////////
\ No newline at end of file
@@ -0,0 +1,207 @@
+/*
+ * oregon_reasm.cpp
+ *
+ *  Created on: 17Oct.,2026
+ */
+
+#include "oregon_reasm.h"
+#include <string.h>
+
+// slot states
+#define REASM_FREE		0
+#define REASM_OPEN		1		// first burst in, waiting for the second one
+#define REASM_DONE		2		// judged, waiting for the older messages to go out
+#define REASM_CLOSED	3		// gone out - kept until the timeout to spot more repeats
+
+#define REASM_KEY(r)	(((uint32_t)(r).sensor_id << 12) | ((uint32_t)(r).channel << 8) | (r).roll_code)
+
+static const oregon_raw_t no_burst = { {0}, 0, 0, 0, 0, OREGON_SYNC_NO_SEARCH };
+
+// an open message from its first burst. A closed one is kept for two timeouts from its last
+// burst: which of its bursts was the sensor's is not known if both were bad, a repeat of
+// that one can open a message up to a timeout later, and be judged a timeout after that.
+static int expired(const oregon_reasm_slot_t *s, uint32_t time_ms)
+{
+	if (s->state == REASM_CLOSED)
+		return (uint32_t)(time_ms - s->last_ms) > 2 * OREGON_REASM_TIMEOUT_MS;
+	return (uint32_t)(time_ms - s->time_ms) > OREGON_REASM_TIMEOUT_MS;
+}
+
+// the open or judged message with the oldest first burst, -1 if none
+static int oldest(const oregon_reasm_t *ra)
+{
+	int i, h = -1;
+
+	for(i = 0; i < OREGON_REASM_SLOTS; i++)
+		if ((ra->slots[i].state == REASM_OPEN || ra->slots[i].state == REASM_DONE) &&
+				(h < 0 || (int32_t)(ra->slots[i].seq - ra->slots[h].seq) < 0))
+			h = i;
+	return h;
+}
+
+static void emit(oregon_reasm_t *ra, oregon_reasm_slot_t *s, oregon_reasm_msg_t *out)
+{
+	if (s->state == REASM_OPEN) {
+		oregon_decode_message(&s->raw, &no_burst, ra->need_both, &out->msg);
+		out->bursts = 1;
+	} else {
+		out->msg = s->msg;
+		out->bursts = 2;
+	}
+	out->tag = s->tag;
+	out->time_ms = s->time_ms;
+	s->state = (s->key != OREGON_REASM_NO_KEY) ? REASM_CLOSED : REASM_FREE;
+}
+
+// messages go out from the oldest on, up to the first one still waiting in time
+static int drain(oregon_reasm_t *ra, uint32_t time_ms, int all, oregon_reasm_msg_t *out)
+{
+	oregon_reasm_slot_t *s;
+	int i, n = 0;
+
+	while ((i = oldest(ra)) >= 0) {
+		s = &ra->slots[i];
+		if (s->state == REASM_OPEN && !all && !expired(s, time_ms))
+			break;
+		emit(ra, s, &out[n++]);
+	}
+	for(i = 0; i < OREGON_REASM_SLOTS; i++) {
+		s = &ra->slots[i];
+		if (s->state == REASM_CLOSED && (all || expired(s, time_ms)))
+			s->state = REASM_FREE;
+	}
+	return n;
+}
+
+// a free slot - the oldest closed one is reused, or else the oldest message goes out
+// unfinished (its first burst was the longest ago)
+static oregon_reasm_slot_t *free_slot(oregon_reasm_t *ra, oregon_reasm_msg_t *out, int *n)
+{
+	oregon_reasm_slot_t *s, *closed = NULL;
+	int i;
+
+	for(i = 0; i < OREGON_REASM_SLOTS; i++) {
+		s = &ra->slots[i];
+		if (s->state == REASM_FREE)
+			return s;
+		if (s->state == REASM_CLOSED && (!closed || (int32_t)(s->seq - closed->seq) < 0))
+			closed = s;
+	}
+	if (closed)
+		return closed;
+	s = &ra->slots[oldest(ra)];
+	emit(ra, s, &out[(*n)++]);
+	return s;
+}
+
+// the message of this sensor, other than skip - NULL if none
+static oregon_reasm_slot_t *find_key(oregon_reasm_t *ra, uint32_t key, const oregon_reasm_slot_t *skip)
+{
+	int i;
+
+	for(i = 0; i < OREGON_REASM_SLOTS; i++)
+		if (ra->slots[i].state != REASM_FREE && ra->slots[i].key == key && &ra->slots[i] != skip)
+			return &ra->slots[i];
+	return NULL;
+}
+
+static oregon_reasm_slot_t *newest_open(oregon_reasm_t *ra, int unknown_only)
+{
+	oregon_reasm_slot_t *s, *newest = NULL;
+	int i;
+
+	for(i = 0; i < OREGON_REASM_SLOTS; i++) {
+		s = &ra->slots[i];
+		if (s->state == REASM_OPEN && (!unknown_only || s->key == OREGON_REASM_NO_KEY) &&
+				(!newest || (int32_t)(s->seq - newest->seq) > 0))
+			newest = s;
+	}
+	return newest;
+}
+
+void oregon_reasm_init(oregon_reasm_t *ra, int need_both)
+{
+	memset(ra, 0, sizeof(*ra));
+	ra->need_both = need_both;
+}
+
+int oregon_reasm_add(oregon_reasm_t *ra, const oregon_raw_t *raw, uint32_t time_ms, uint64_t tag,
+		uint8_t *role, uint8_t *sync_offset, oregon_reasm_msg_t *out)
+{
+	oregon_reasm_slot_t *s = NULL;
+	oregon_frame_t frame;
+	uint32_t key = OREGON_REASM_NO_KEY;
+	int n;
+
+	n = drain(ra, time_ms, 0, out);
+	if (oregon_decode_frame(raw->data, raw->len, raw->rssi_raw, raw->lqi_raw, &frame) == OREGON_OK)
+		key = REASM_KEY(frame.reading);
+	*sync_offset = frame.sync_offset;
+	// the message of this sensor; else the newest open one whose sensor is not known -
+	// or any, if this burst's is not known either
+	if (key != OREGON_REASM_NO_KEY)
+		s = find_key(ra, key, NULL);
+	if (s && s->state != REASM_OPEN) {
+		*role = OREGON_REASM_SPURIOUS;
+		return n;
+	}
+	if (!s)
+		s = newest_open(ra, key != OREGON_REASM_NO_KEY);
+	if (s) {
+		// the first burst did not decode - it may have been another sensor's, so the message
+		// is of this burst from now on: it times out from here, and comes out in its place
+		if (s->key == OREGON_REASM_NO_KEY && key != OREGON_REASM_NO_KEY) {
+			s->time_ms = time_ms;
+			s->seq = ra->seq++;
+		}
+		oregon_decode_message(&s->raw, raw, ra->need_both, &s->msg);
+		if (s->msg.good)
+			s->key = REASM_KEY(s->msg.reading);
+		else if (s->key == OREGON_REASM_NO_KEY)
+			s->key = key;
+		// two bad bursts can rebuild the reading of a sensor whose message is open or
+		// out already - the repeat of a damaged burst paired with another sensor's
+		if (s->key != OREGON_REASM_NO_KEY && find_key(ra, s->key, s)) {
+			s->state = REASM_FREE;
+			*role = OREGON_REASM_SPURIOUS;
+			return n;
+		}
+		s->tag = tag;
+		s->last_ms = time_ms;
+		s->state = REASM_DONE;
+		*role = OREGON_REASM_SECOND;
+	} else {
+		s = free_slot(ra, out, &n);
+		s->raw = *raw;
+		s->tag = tag;
+		s->time_ms = s->last_ms = time_ms;
+		s->key = key;
+		s->seq = ra->seq++;
+		s->state = REASM_OPEN;
+		*role = OREGON_REASM_FIRST;
+	}
+	return n + drain(ra, time_ms, 0, out + n);
+}
+
+int oregon_reasm_expire(oregon_reasm_t *ra, uint32_t time_ms, oregon_reasm_msg_t *out)
+{
+	return drain(ra, time_ms, 0, out);
+}
+
+int oregon_reasm_flush(oregon_reasm_t *ra, oregon_reasm_msg_t *out)
+{
+	return drain(ra, 0, 1, out);
+}
+
+int oregon_reasm_next_ms(const oregon_reasm_t *ra, uint32_t time_ms)
+{
+	const oregon_reasm_slot_t *s;
+	uint32_t age;
+	int i;
+
+	if ((i = oldest(ra)) < 0)
+		return -1;
+	s = &ra->slots[i];
+	age = time_ms - s->time_ms;
+	return (s->state == REASM_DONE || age > OREGON_REASM_TIMEOUT_MS) ? 0 : OREGON_REASM_TIMEOUT_MS + 1 - age;
+}
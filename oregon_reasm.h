@@ -0,0 +1,69 @@
+/*
+ * oregon_reasm.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  Reassembly of Oregon v2.1 messages from FIFO bursts. A sensor sends every
+ *  message twice; with several sensors on the air the bursts of two messages
+ *  can interleave, so a burst is not paired with the one before it but with the
+ *  open message of the same sensor - ID, channel and roll code, as decoded from
+ *  the burst. A burst that does not decode that far goes with the newest open
+ *  message. A message whose second burst does not come within the timeout is
+ *  judged alone. Messages come out in the order of their first bursts.
+ *  No I/O and no globals - used by the receiver and by oregon_batch alike.
+ */
+
+#ifndef OREGON_REASM_H_
+#define OREGON_REASM_H_
+
+#include <stdint.h>
+#include "oregon_decoder.h"
+
+#define OREGON_REASM_SLOTS		16		// messages open (or just closed) at once
+#define OREGON_REASM_TIMEOUT_MS	1000	// all bursts of a message come within this of the first one
+#define OREGON_REASM_NO_KEY		0xffffffff
+
+// role of a burst in its message
+#define OREGON_REASM_FIRST		1		// opened a message
+#define OREGON_REASM_SECOND		2		// completed one
+#define OREGON_REASM_SPURIOUS	3		// another repeat of a complete message - only counted
+
+typedef struct {
+	oregon_raw_t raw;			// first burst
+	oregon_message_t msg;		// judged once the second burst came
+	uint64_t tag;				// caller's tag of the last burst so far
+	uint32_t time_ms;			// of the first burst
+	uint32_t last_ms;			// of the last burst so far - a closed message is kept after it
+	uint32_t key;				// sensor of the message, OREGON_REASM_NO_KEY - not known (yet)
+	uint32_t seq;				// order of the first bursts
+	uint8_t  state;
+} oregon_reasm_slot_t;
+
+typedef struct {
+	oregon_reasm_slot_t slots[OREGON_REASM_SLOTS];
+	uint32_t seq;
+	int need_both;
+} oregon_reasm_t;
+
+typedef struct {
+	oregon_message_t msg;		// a lone burst is judged with an empty second one
+	uint64_t tag;				// caller's tag of the last burst
+	uint32_t time_ms;			// of the first burst
+	uint8_t  bursts;			// 2, or 1 - the other burst never came
+} oregon_reasm_msg_t;
+
+// need_both - as for oregon_decode_message()
+void oregon_reasm_init(oregon_reasm_t *ra, int need_both);
+// a burst received at time_ms (wraps as millis()). Its role goes to *role and the sync offset
+// of the burst alone to *sync_offset. The messages completed by it, or whose time is up,
+// go to out (room for OREGON_REASM_SLOTS), oldest first - returns how many.
+int oregon_reasm_add(oregon_reasm_t *ra, const oregon_raw_t *raw, uint32_t time_ms, uint64_t tag,
+		uint8_t *role, uint8_t *sync_offset, oregon_reasm_msg_t *out);
+// the messages whose time is up at time_ms, as above
+int oregon_reasm_expire(oregon_reasm_t *ra, uint32_t time_ms, oregon_reasm_msg_t *out);
+// all open messages, at the end of the input
+int oregon_reasm_flush(oregon_reasm_t *ra, oregon_reasm_msg_t *out);
+// ms from time_ms until the oldest open message times out, -1 - none open
+int oregon_reasm_next_ms(const oregon_reasm_t *ra, uint32_t time_ms);
+
+#endif /* OREGON_REASM_H_ */
@@ -0,0 +1,111 @@
+/*
+ * oregon_ring.cpp
+ *
+ *  Created on: 17Oct.,2026
+ */
+
+#include "oregon_ring.h"
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+static void futex_wait(uint32_t *word, uint32_t val, int timeout_ms)
+{
+	struct timespec ts = { timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+
+	syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, val, (timeout_ms < 0) ? NULL : &ts, NULL, 0);
+}
+
+static void futex_wake(uint32_t *word)
+{
+	syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+void oregon_ring_init(oregon_ring_t *r, void *slots, uint32_t slot_size, uint32_t len)
+{
+	r->head = r->tail = 0;
+	r->producer_waits = r->consumer_waits = 0;
+	r->closed = 0;
+	r->slots = (uint8_t *)slots;
+	r->slot_size = slot_size;
+	r->mask = len - 1;
+}
+
+//-----------------------[producer]---------------------------------------------
+void *oregon_ring_claim(oregon_ring_t *r)
+{
+	uint32_t head = r->head;
+
+	if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) > r->mask)
+		return NULL;
+	return r->slots + (size_t)(head & r->mask) * r->slot_size;
+}
+
+// the waits flag is read after head is stored (and set before head is read on the other
+// side), so either the consumer sees the new slot or it is woken
+void oregon_ring_push(oregon_ring_t *r)
+{
+	__atomic_store_n(&r->head, r->head + 1, __ATOMIC_RELEASE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&r->consumer_waits, __ATOMIC_RELAXED))
+		futex_wake(&r->head);
+}
+
+void oregon_ring_close(oregon_ring_t *r)
+{
+	__atomic_store_n(&r->closed, 1, __ATOMIC_RELEASE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	futex_wake(&r->head);
+}
+
+void oregon_ring_wait_space(oregon_ring_t *r, int timeout_ms)
+{
+	uint32_t tail;
+
+	__atomic_store_n(&r->producer_waits, 1, __ATOMIC_SEQ_CST);
+	tail = __atomic_load_n(&r->tail, __ATOMIC_SEQ_CST);
+	if (r->head - tail > r->mask)
+		futex_wait(&r->tail, tail, timeout_ms);
+	__atomic_store_n(&r->producer_waits, 0, __ATOMIC_RELAXED);
+}
+//-------------------------------[end]------------------------------------------
+
+//-----------------------[consumer]---------------------------------------------
+void *oregon_ring_peek(oregon_ring_t *r)
+{
+	uint32_t tail = r->tail;
+
+	if (tail == __atomic_load_n(&r->head, __ATOMIC_ACQUIRE))
+		return NULL;
+	return r->slots + (size_t)(tail & r->mask) * r->slot_size;
+}
+
+void oregon_ring_pop(oregon_ring_t *r)
+{
+	__atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_RELEASE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&r->producer_waits, __ATOMIC_RELAXED))
+		futex_wake(&r->tail);
+}
+
+// closed is stored after the last push, so head is final once it is seen
+int oregon_ring_done(oregon_ring_t *r)
+{
+	return __atomic_load_n(&r->closed, __ATOMIC_ACQUIRE) &&
+			r->tail == __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+}
+
+void oregon_ring_wait_data(oregon_ring_t *r, int timeout_ms)
+{
+	uint32_t head;
+
+	__atomic_store_n(&r->consumer_waits, 1, __ATOMIC_SEQ_CST);
+	head = __atomic_load_n(&r->head, __ATOMIC_SEQ_CST);
+	if (head == r->tail && !__atomic_load_n(&r->closed, __ATOMIC_ACQUIRE))
+		futex_wait(&r->head, head, timeout_ms);
+	__atomic_store_n(&r->consumer_waits, 0, __ATOMIC_RELAXED);
+}
+//-------------------------------[end]------------------------------------------
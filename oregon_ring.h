@@ -0,0 +1,54 @@
+/*
+ * oregon_ring.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  Bounded single producer / single consumer ring of preallocated slots, as
+ *  used between the receiver threads of 'oregon_read'. The producer fills a
+ *  slot in place (claim, then push), the consumer uses it in place (peek, then
+ *  pop) - nothing is copied or allocated. Neither side takes a lock; a side
+ *  that has to wait sleeps on a futex and is only woken when it said so.
+ */
+
+#ifndef OREGON_RING_H_
+#define OREGON_RING_H_
+
+#include <stdint.h>
+
+#define OREGON_RING_CACHELINE	64
+
+typedef struct {
+	// producer side
+	uint32_t head __attribute__((aligned(OREGON_RING_CACHELINE)));	// slots ever pushed - futex word
+	uint32_t producer_waits;
+	uint32_t closed;
+	// consumer side
+	uint32_t tail __attribute__((aligned(OREGON_RING_CACHELINE)));	// slots ever popped - futex word
+	uint32_t consumer_waits;
+	// fixed
+	uint8_t *slots __attribute__((aligned(OREGON_RING_CACHELINE)));
+	uint32_t slot_size;
+	uint32_t mask;				// len - 1, len is a power of 2
+} oregon_ring_t;
+
+// slots: len (a power of 2) slots of slot_size bytes, owned by the caller
+void oregon_ring_init(oregon_ring_t *r, void *slots, uint32_t slot_size, uint32_t len);
+
+// producer: the next free slot, NULL if the ring is full; push makes it visible
+void *oregon_ring_claim(oregon_ring_t *r);
+void oregon_ring_push(oregon_ring_t *r);
+// producer: no more slots follow - the consumer gets the rest, then oregon_ring_done()
+void oregon_ring_close(oregon_ring_t *r);
+
+// consumer: the oldest pushed slot, NULL if none; pop hands it back to the producer
+void *oregon_ring_peek(oregon_ring_t *r);
+void oregon_ring_pop(oregon_ring_t *r);
+// consumer: closed and every slot taken
+int oregon_ring_done(oregon_ring_t *r);
+
+// sleep until a slot is pushed (consumer) or popped (producer), the ring is closed,
+// or timeout_ms passed (-1 - no timeout). Returns at once if there is no need to wait.
+void oregon_ring_wait_data(oregon_ring_t *r, int timeout_ms);
+void oregon_ring_wait_space(oregon_ring_t *r, int timeout_ms);
+
+#endif /* OREGON_RING_H_ */
@@ -0,0 +1,132 @@
+/*
+ * oregon_sched.cpp
+ *
+ *  Created on: 17Oct.,2026
+ */
+
+#include "oregon_sched.h"
+#include <string.h>
+
+// times wrap as millis() - compared by their difference
+#define AFTER(a, b)		((int32_t)((a) - (b)) > 0)
+
+static uint32_t guard_ms(const oregon_sched_sensor_t *s)
+{
+	return OREGON_SCHED_GUARD_MS + (uint64_t)(s->due_ms - s->last_ms) * OREGON_SCHED_DRIFT_PPM / 1000000;
+}
+
+void oregon_sched_init(oregon_sched_t *sc, uint32_t now_ms)
+{
+	memset(sc, 0, sizeof(*sc));
+	sc->learn_ms = now_ms;
+}
+
+uint32_t oregon_sched_key(const oregon_data_t *r)
+{
+	return ((uint32_t)r->sensor_id << 12) | ((uint32_t)r->channel << 8) | r->roll_code;
+}
+
+// a new sensor takes a free slot, or the one not heard for the longest
+uint32_t oregon_sched_heard(oregon_sched_t *sc, uint32_t key, uint32_t time_ms)
+{
+	oregon_sched_sensor_t *s, *found = NULL, *old = NULL;
+	uint32_t d, k, err;
+	int i;
+
+	for(i = 0; i < OREGON_SCHED_SENSORS && !found; i++) {
+		s = &sc->sensors[i];
+		if (s->used && s->key == key)
+			found = s;
+		else if (!old || (old->used && (!s->used || AFTER(old->last_ms, s->last_ms))))
+			old = s;
+	}
+	if (!found) {
+		memset(old, 0, sizeof(*old));
+		old->key = key;
+		old->last_ms = time_ms;
+		old->used = 1;
+		return 0;
+	}
+	s = found;
+	d = time_ms - s->last_ms;
+	if (d < OREGON_SCHED_MIN_PERIOD_MS)
+		return d ? d : 1;		// the repeat of the message heard last
+	// an interval of k periods (messages missed meanwhile) refines the period; a shorter
+	// one means the period learned so far was a multiple, any other one starts over
+	if (s->period_ms) {
+		k = (d + s->period_ms / 2) / s->period_ms;
+		err = (d > k * s->period_ms) ? d - k * s->period_ms : k * s->period_ms - d;
+		if (k >= 1 && err <= s->period_ms / 8)
+			s->period_ms = (3 * s->period_ms + d / k) / 4;
+		else
+			s->period_ms = (d < s->period_ms) ? d : 0;
+	} else
+		s->period_ms = d;
+	s->last_ms = time_ms;
+	s->due_ms = time_ms + s->period_ms;
+	s->misses = 0;
+	return 0;
+}
+
+uint32_t oregon_sched_learning(oregon_sched_t *sc, uint32_t now_ms)
+{
+	if (now_ms - sc->learn_ms >= OREGON_SCHED_RELEARN_MS)
+		sc->learn_ms = now_ms;
+	if (now_ms - sc->learn_ms < OREGON_SCHED_LEARN_MS)
+		return OREGON_SCHED_LEARN_MS - (now_ms - sc->learn_ms);
+	return 0;
+}
+
+uint32_t oregon_sched_next(oregon_sched_t *sc, uint32_t now_ms, uint32_t *listen_ms)
+{
+	oregon_sched_sensor_t *s;
+	uint32_t sleep_ms = OREGON_SCHED_MAX_SLEEP_MS, start, end;
+	int i, known = 0;
+
+	if ((*listen_ms = oregon_sched_learning(sc, now_ms)) > 0)
+		return 0;
+	*listen_ms = OREGON_SCHED_MIN_SLEEP_MS;
+	for(i = 0; i < OREGON_SCHED_SENSORS; i++) {
+		s = &sc->sensors[i];
+		if (!s->used)
+			continue;
+		if (AFTER(s->last_ms + OREGON_SCHED_MSG_MS, now_ms)) {
+			*listen_ms = s->last_ms + OREGON_SCHED_MSG_MS - now_ms;
+			return 0;				// the repeat of the message just heard
+		}
+		if (!s->period_ms) {
+			if (now_ms - s->last_ms < OREGON_SCHED_MAX_PERIOD_MS)
+				return 0;
+			s->used = 0;	// heard once, never again
+			continue;
+		}
+		// every window that passed without the sensor is a miss
+		while (!AFTER(s->due_ms + OREGON_SCHED_MSG_MS + guard_ms(s), now_ms)) {
+			s->misses++;
+			sc->misses++;
+			s->due_ms += s->period_ms;
+		}
+		if (s->misses > OREGON_SCHED_MAX_MISSES) {
+			s->used = 0;
+			continue;
+		}
+		if (s->misses)
+			return 0;
+		start = s->due_ms - guard_ms(s);
+		end = s->due_ms + OREGON_SCHED_MSG_MS + guard_ms(s);
+		if (!AFTER(start, now_ms)) {
+			*listen_ms = end - now_ms;
+			return 0;
+		}
+		if (start - now_ms < sleep_ms)
+			sleep_ms = start - now_ms;
+		known++;
+	}
+	if (!known)
+		return 0;
+	if (sleep_ms < OREGON_SCHED_MIN_SLEEP_MS) {
+		*listen_ms = sleep_ms;
+		return 0;
+	}
+	return sleep_ms;
+}
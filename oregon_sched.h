@@ -0,0 +1,59 @@
+/*
+ * oregon_sched.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  Predictive receive schedule, as used by 'oregon_read -s'. An Oregon sensor
+ *  transmits on a fixed period (39/41/43 s for a THN122N on channel 1/2/3), so
+ *  once the period and phase of every sensor in range are known, the radio only
+ *  has to listen around the expected messages. Periods are learned from the Rx
+ *  times; the radio listens all the time while learning (at the start and then
+ *  every hour, for sensors added meanwhile) and after any missed message, until
+ *  the sensor is heard again. No I/O - times are the caller's millis().
+ */
+
+#ifndef OREGON_SCHED_H_
+#define OREGON_SCHED_H_
+
+#include <stdint.h>
+#include "oregon_decoder.h"
+
+#define OREGON_SCHED_SENSORS		32
+#define OREGON_SCHED_LEARN_MS		120000		// continuous Rx to find the sensors and their periods...
+#define OREGON_SCHED_RELEARN_MS		3600000		// ...at the start and this often
+#define OREGON_SCHED_MIN_PERIOD_MS	5000		// bursts closer than this are one message
+#define OREGON_SCHED_MAX_PERIOD_MS	120000		// a sensor not heard again within this is dropped
+#define OREGON_SCHED_MSG_MS			500			// from the first burst read to the end of the second one
+#define OREGON_SCHED_GUARD_MS		500			// listening starts this early and ends this late...
+#define OREGON_SCHED_DRIFT_PPM		5000		// ...plus this much of the time since the sensor was heard
+#define OREGON_SCHED_MIN_SLEEP_MS	1000		// shorter gaps are listened through
+#define OREGON_SCHED_MAX_SLEEP_MS	60000		// the schedule is looked at again at least this often
+#define OREGON_SCHED_MAX_MISSES		3			// messages missed in a row, then the sensor is dropped
+
+typedef struct {
+	uint32_t key;				// oregon_sched_key()
+	uint32_t last_ms;			// first burst of the last message heard
+	uint32_t due_ms;			// of the next message
+	uint32_t period_ms;			// 0 - not learned yet
+	uint8_t  misses;			// messages missed in a row
+	uint8_t  used;
+} oregon_sched_sensor_t;
+
+typedef struct {
+	oregon_sched_sensor_t sensors[OREGON_SCHED_SENSORS];
+	uint32_t learn_ms;			// start of the last learning period
+	unsigned long misses;		// messages not heard when expected, in total
+} oregon_sched_t;
+
+void oregon_sched_init(oregon_sched_t *sc, uint32_t now_ms);
+// sensor ID, channel and roll code of a decoded reading
+uint32_t oregon_sched_key(const oregon_data_t *r);
+// a burst of the sensor with this key, read at time_ms - returns 0 if it is the first one heard
+// of its message, else ms since that one (the bursts are read at their end, so their spacing)
+uint32_t oregon_sched_heard(oregon_sched_t *sc, uint32_t key, uint32_t time_ms);
+// ms left of the learning period now_ms is in, 0 - not learning
+uint32_t oregon_sched_learning(oregon_sched_t *sc, uint32_t now_ms);
+// ms from now_ms the radio may sleep; 0 - listen, for *listen_ms before asking again
+uint32_t oregon_sched_next(oregon_sched_t *sc, uint32_t now_ms, uint32_t *listen_ms);
+
+#endif /* OREGON_SCHED_H_ */
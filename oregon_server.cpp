@@ -0,0 +1,464 @@
+/*
+ * oregon_server.cpp
+ *
+ *  Created on: 17Oct.,2026
+ */
+
+#include "oregon_server.h"
+#include "oregon_metrics.h"
+#include "oregon_pipeline.h"
+#include "oregon_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define QUERY_MAX_CLIENTS	64		// query socket connections served at once
+#define QUERY_REPLY_MAX		(sizeof(oregon_reply_t) + OREGON_Q_MAX_RECORDS * sizeof(oregon_data_t))
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) < (b) ? (b) : (a))
+
+// a connection to the query socket, with the reply packets it did not take yet
+struct QUERY_CLIENT {
+	int	fd;
+	uint8_t	*out;
+	size_t	out_len, out_pos, out_size;
+};
+
+char	*query_path		=	NULL;
+int	query_epfd		=	-1;
+struct INSTANCE *query_snap	=	NULL;
+static int	query_fd		=	-1;
+static int	query_stop_fd		=	-1;	// eventfd - ends the query thread
+static pthread_t query_thread;
+static struct QUERY_CLIENT query_clients[QUERY_MAX_CLIENTS];
+
+static void   *query_server(void *arg);
+static void    query_accept(int epfd);
+static void    query_serve(int epfd, struct QUERY_CLIENT *c, uint32_t events);
+static void    query_reply(struct QUERY_CLIENT *c, oregon_query_t *q, ssize_t len);
+static void    query_stats(struct INSTANCE *snap, struct SENSOR *s, oregon_q_stats_t *st);
+static void    query_add(struct QUERY_CLIENT *c, oregon_query_t *q, uint8_t status, uint8_t more, const void *rec, uint16_t count, uint16_t rec_size);
+static int     query_flush(struct QUERY_CLIENT *c);
+static void    query_close(struct QUERY_CLIENT *c);
+
+void query_begin()
+{
+	if (query_path && (query_fd = unix_listen(query_path, SOCK_SEQPACKET)) == -1)
+		Msg("Cannot serve queries on %s (%s) - no query server.", query_path, strerror(errno));
+	metrics_begin();
+	if (query_fd == -1 && metrics_fd == -1)
+		return;
+	// allocated only now - under -T all memory is locked
+	if (!(query_snap = (struct INSTANCE *)malloc(sizeof(struct INSTANCE)))) {
+		Msg("No memory for the state snapshot - no query server.");
+		query_end();
+		return;
+	}
+	if ((query_stop_fd = eventfd(0, EFD_CLOEXEC)) == -1) {
+		Msg("Cannot create eventfd (%s) - no query server.", strerror(errno));
+		query_end();
+		return;
+	}
+	if (!start_thread(&query_thread, query_server)) {
+		Msg("Cannot start the query server thread - no query server.");
+		close(query_stop_fd);
+		query_stop_fd = -1;
+		query_end();
+	}
+}
+
+void query_end()
+{
+	uint64_t one = 1;
+
+	if (query_stop_fd != -1) {
+		if (write(query_stop_fd, &one, sizeof(one)) == sizeof(one))
+			pthread_join(query_thread, NULL);
+		close(query_stop_fd);
+		query_stop_fd = -1;
+	}
+	if (query_fd != -1) {
+		close(query_fd);
+		unlink(query_path);
+		query_fd = -1;
+	}
+	metrics_end();
+	free(query_snap);
+	query_snap = NULL;
+}
+
+// a non-blocking listening socket open to all local users
+int unix_listen(const char *path, int type)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	if ((fd = socket(AF_UNIX, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1)
+		return -1;
+	if ((unlink(path) != 0 && errno != ENOENT) || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+			chmod(path, 0666) != 0 || listen(fd, SOMAXCONN) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+// a non-blocking listening TCP socket on the loopback interface only
+int tcp_listen(int port)
+{
+	struct sockaddr_in addr;
+	int fd, on = 1;
+
+	if (port <= 0 || port > 0xffff) {
+		errno = EINVAL;
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if ((fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1)
+		return -1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static void *query_server(void *arg)
+{
+	struct epoll_event ev, events[QUERY_MAX_CLIENTS + METRICS_MAX_CLIENTS + 3];
+	struct METRICS_CLIENT *mc;
+	int epfd, n, i;
+
+	for(i = 0; i < QUERY_MAX_CLIENTS; i++)
+		query_clients[i].fd = -1;
+	if ((epfd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+		Msg("Query server: no epoll (%s).", strerror(errno));
+		return NULL;
+	}
+	query_epfd = epfd;
+	// the listening sockets and the stop eventfd are told apart from clients by data.ptr
+	ev.events = EPOLLIN;
+	ev.data.ptr = &query_stop_fd;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, query_stop_fd, &ev);
+	if (query_fd != -1) {
+		ev.data.ptr = &query_fd;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, query_fd, &ev);
+	}
+	if (metrics_fd != -1) {
+		ev.data.ptr = &metrics_fd;
+		epoll_ctl(epfd, EPOLL_CTL_ADD, metrics_fd, &ev);
+	}
+	while (1) {
+		if ((n = epoll_wait(epfd, events, QUERY_MAX_CLIENTS + METRICS_MAX_CLIENTS + 3, -1)) == -1) {
+			if (errno == EINTR)
+				continue;
+			Msg("Query server: epoll failed (%s).", strerror(errno));
+			break;
+		}
+		for(i = 0; i < n; i++) {
+			if (events[i].data.ptr == &query_stop_fd)
+				goto done;
+			else if (events[i].data.ptr == &query_fd)
+				query_accept(epfd);
+			else if (events[i].data.ptr == &metrics_fd)
+				metrics_accept(epfd);
+			else if ((mc = metrics_client(events[i].data.ptr)) != NULL)
+				metrics_serve(epfd, mc, events[i].events);
+			else
+				query_serve(epfd, (struct QUERY_CLIENT *)events[i].data.ptr, events[i].events);
+		}
+	}
+done:
+	for(i = 0; i < QUERY_MAX_CLIENTS; i++) {
+		if (query_clients[i].fd != -1)
+			query_close(&query_clients[i]);
+		free(query_clients[i].out);
+		query_clients[i].out = NULL;
+		query_clients[i].out_size = 0;
+	}
+	metrics_close_all();
+	close(epfd);
+	query_epfd = -1;
+	return NULL;
+}
+
+static void query_accept(int epfd)
+{
+	struct epoll_event ev;
+	struct QUERY_CLIENT *c;
+	int fd, i;
+
+	while ((fd = accept4(query_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+		for(i = 0, c = NULL; i < QUERY_MAX_CLIENTS && !c; i++)
+			if (query_clients[i].fd == -1)
+				c = &query_clients[i];
+		if (!c) {		// busy - the client sees the connection closed
+			close(fd);
+			continue;
+		}
+		c->fd = fd;
+		c->out_len = c->out_pos = 0;
+		ev.events = EPOLLIN;
+		ev.data.ptr = c;
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0)
+			query_close(c);
+	}
+}
+
+// a client is read only when all of its replies are sent - one query at a time
+static void query_serve(int epfd, struct QUERY_CLIENT *c, uint32_t events)
+{
+	struct epoll_event ev;
+	oregon_query_t q;
+	ssize_t len;
+
+	if (events & EPOLLERR) {
+		query_close(c);
+		return;
+	}
+	if (!c->out_len && (events & (EPOLLIN | EPOLLHUP))) {
+		len = recv(c->fd, &q, sizeof(q), MSG_TRUNC);
+		if (len == 0 || (len == -1 && errno != EAGAIN && errno != EINTR)) {
+			query_close(c);
+			return;
+		}
+		if (len > 0)
+			query_reply(c, &q, len);
+	}
+	if (!query_flush(c)) {
+		query_close(c);
+		return;
+	}
+	ev.events = c->out_len ? EPOLLOUT : EPOLLIN;
+	ev.data.ptr = c;
+	if (epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev) != 0)
+		query_close(c);
+}
+
+static void query_reply(struct QUERY_CLIENT *c, oregon_query_t *q, ssize_t len)
+{
+	struct INSTANCE *snap = query_snap;
+	static oregon_data_t r[OREGON_HISTORY_LEN];
+	oregon_q_stats_t st;
+	struct SENSOR *s;
+	int slot, i, n;
+
+	if (len != sizeof(*q) || q->version != OREGON_QUERY_VERSION ||
+			q->type < OREGON_Q_LATEST || q->type > OREGON_Q_HISTORY) {
+		query_add(c, q, OREGON_Q_EINVAL, 0, NULL, 0, 0);
+		return;
+	}
+	shm_snapshot(my_instance, snap, q->type == OREGON_Q_STATS);
+	switch (q->type) {
+	case OREGON_Q_LATEST:
+		for(slot = n = 0; slot < OREGON_MAX_SENSORS; slot++)
+			if (sensor_match(&snap->sensors[slot], q->id, q->channel, q->roll_code))
+				r[n++] = snap->sensors[slot].oregon_data;
+		query_add(c, q, OREGON_Q_OK, 0, r, n, sizeof(oregon_data_t));
+		break;
+	case OREGON_Q_STATS:
+		s = NULL;
+		if (q->id >= 0 || q->channel >= 0 || q->roll_code >= 0) {
+			if ((s = find_sensor(snap, q->id, q->channel, q->roll_code)) == NULL) {
+				query_add(c, q, OREGON_Q_OK, 0, NULL, 0, sizeof(st));
+				break;
+			}
+		}
+		query_stats(snap, s, &st);
+		query_add(c, q, OREGON_Q_OK, 0, &st, 1, sizeof(st));
+		break;
+	case OREGON_Q_HISTORY:
+		for(slot = 0; slot < OREGON_MAX_SENSORS; slot++) {
+			if (!sensor_match(&snap->sensors[slot], q->id, q->channel, q->roll_code))
+				continue;
+			n = read_history(my_instance, snap, slot, r, q->last, q->since, NULL);
+			for(i = 0; i < n; i += OREGON_Q_MAX_RECORDS)
+				query_add(c, q, OREGON_Q_OK, 1, &r[i], MIN(n - i, OREGON_Q_MAX_RECORDS), sizeof(oregon_data_t));
+		}
+		query_add(c, q, OREGON_Q_OK, 0, NULL, 0, sizeof(oregon_data_t));
+		break;
+	}
+}
+
+static void query_stats(struct INSTANCE *snap, struct SENSOR *s, oregon_q_stats_t *st)
+{
+	struct RX_HISTS *h = s ? &snap->sensor_hists[s - snap->sensors] : &snap->hists;
+	static const unsigned int pct[3] = { 50, 90, 99 };
+	unsigned long good;
+	int i;
+
+	memset(st, 0, sizeof(*st));
+	if (s) {
+		good = s->good_reads;
+		st->total_reads = good;
+		st->combined_reads = s->combined_reads;
+		st->min_intvl = s->min_intvl;
+		st->max_intvl = s->max_intvl;
+		st->last_upd_time = s->oregon_data.time;
+		st->sensor_count = 1;
+		st->max_temp_diff = s->max_temp_diff;
+		st->rssi_min = s->rssi_min;
+		st->rssi_max = s->rssi_max;
+		st->lqi_min = s->lqi_min;
+		st->lqi_max = s->lqi_max;
+		if (good) {
+			st->rssi_avg = s->rssi_sum / (int64_t)good;
+			st->lqi_avg = s->lqi_sum / good;
+		}
+	} else {
+		good = snap->good_reads;
+		st->total_reads = snap->total_reads;
+		st->combined_reads = snap->combined_reads;
+		st->brst1_errors = snap->brst1_errors;
+		st->brst2_errors = snap->brst2_errors;
+		st->mbrst_errors = snap->mbrst_errors;
+		st->pktlen_errors = snap->pktlen_errors;
+		st->buffmatch_errors = snap->buffmatch_errors;
+		st->chksum_errors = snap->chksum_errors;
+		st->min_intvl = snap->min_intvl;
+		st->max_intvl = snap->max_intvl;
+		st->last_upd_time = snap->last_upd_time;
+		st->sensor_count = snap->sensor_count;
+		st->max_temp_diff = snap->max_temp_diff;
+		st->rssi_min = snap->rssi_min;
+		st->rssi_max = snap->rssi_max;
+		st->lqi_min = snap->lqi_min;
+		st->lqi_max = snap->lqi_max;
+		if (good) {
+			st->rssi_avg = snap->rssi_sum / (int64_t)good;
+			st->lqi_avg = snap->lqi_sum / good;
+		}
+	}
+	st->good_reads = good;
+	for(i = 0; i < 3; i++) {
+		st->rssi_pct[i] = -(int)oregon_hist_percentile(&h->rssi, pct[i]);
+		st->lqi_pct[i] = oregon_hist_percentile(&h->lqi, pct[i]);
+		st->intvl_pct[i] = oregon_hist_percentile(&h->intvl, pct[i]);
+		st->latency_pct[i] = oregon_hist_percentile(&h->latency, pct[i]);
+	}
+}
+
+// queue one reply packet
+static void query_add(struct QUERY_CLIENT *c, oregon_query_t *q, uint8_t status, uint8_t more, const void *rec, uint16_t count, uint16_t rec_size)
+{
+	oregon_reply_t rep;
+	size_t size = sizeof(rep) + (size_t)count * rec_size;
+	uint8_t *out;
+
+	if (c->out_len + size > c->out_size) {
+		if ((out = (uint8_t *)realloc(c->out, MAX(c->out_len + size, 2 * c->out_size))) == NULL)
+			return;		// the client gets no more packets and waits - its problem
+		c->out = out;
+		c->out_size = MAX(c->out_len + size, 2 * c->out_size);
+	}
+	rep.version = OREGON_QUERY_VERSION;
+	rep.type = q->type;
+	rep.status = status;
+	rep.more = more;
+	rep.rec_size = rec_size;
+	rep.count = count;
+	rep.time = time(NULL);
+	rep.data_invalid_timeout = my_instance->data_invalid_timeout;
+	memcpy(c->out + c->out_len, &rep, sizeof(rep));
+	if (count)
+		memcpy(c->out + c->out_len + sizeof(rep), rec, (size_t)count * rec_size);
+	c->out_len += size;
+}
+
+// send the queued packets while the socket takes them; FALSE - the client is gone
+static int query_flush(struct QUERY_CLIENT *c)
+{
+	oregon_reply_t *rep;
+	size_t size;
+
+	while (c->out_pos < c->out_len) {
+		rep = (oregon_reply_t *)(c->out + c->out_pos);
+		size = sizeof(*rep) + (size_t)rep->count * rep->rec_size;
+		if (send(c->fd, rep, size, MSG_NOSIGNAL) == -1)
+			return (errno == EAGAIN || errno == EINTR);
+		c->out_pos += size;
+	}
+	c->out_len = c->out_pos = 0;
+	return TRUE;
+}
+
+static void query_close(struct QUERY_CLIENT *c)
+{
+	close(c->fd);		// also removes it from the epoll set
+	c->fd = -1;
+	c->out_len = c->out_pos = 0;
+}
+
+//-----------------------[client]-----------------------------------------------
+// a blocking connection; every packet is checked against the query before fn gets it
+long query_request(const char *path, const oregon_query_t *q,
+		void (*fn)(const oregon_reply_t *rep, const void *recs, void *arg), void *arg)
+{
+	uint8_t buf[QUERY_REPLY_MAX] __attribute__((aligned(8)));
+	oregon_reply_t *rep = (oregon_reply_t *)buf;
+	struct sockaddr_un addr;
+	size_t rec_size = (q->type == OREGON_Q_STATS) ? sizeof(oregon_q_stats_t) : sizeof(oregon_data_t);
+	long total = 0;
+	ssize_t len;
+	int fd, err;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	if ((fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) == -1)
+		return -1;
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+			send(fd, q, sizeof(*q), MSG_NOSIGNAL) != (ssize_t)sizeof(*q))
+		goto fail;
+	do {
+		// MSG_TRUNC - the length of the whole packet, even if it did not fit
+		if ((len = recv(fd, buf, sizeof(buf), MSG_TRUNC)) <= 0) {
+			if (len == 0)
+				errno = ECONNRESET;
+			goto fail;
+		}
+		if ((size_t)len < sizeof(*rep) || rep->version != OREGON_QUERY_VERSION || rep->type != q->type ||
+				rep->status != OREGON_Q_OK || rep->rec_size != rec_size || rep->count > OREGON_Q_MAX_RECORDS ||
+				(size_t)len != sizeof(*rep) + (size_t)rep->count * rep->rec_size) {
+			errno = EPROTO;
+			goto fail;
+		}
+		if (fn)
+			fn(rep, buf + sizeof(*rep), arg);
+		total += rep->count;
+	} while (rep->more);
+	close(fd);
+	return total;
+fail:
+	err = errno;
+	close(fd);
+	errno = err;
+	return -1;
+}
+//-------------------------------[end]------------------------------------------
@@ -0,0 +1,31 @@
+/*
+ * oregon_server.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  Query server of 'oregon_read': with -Q and -M a thread serves
+ *  oregon_query.h requests and OpenMetrics scrapes (oregon_metrics.h) through
+ *  epoll. It reads the instance the way the clients do (shm_snapshot), so the
+ *  radio loop never waits for it. query_request() is the client side.
+ */
+
+#ifndef OREGON_SERVER_H_
+#define OREGON_SERVER_H_
+
+#include "oregon_instance.h"
+#include "oregon_query.h"
+
+extern char	*query_path;		// -Q - serve oregon_query.h requests on this socket
+extern int	query_epfd;			// of the server thread, -1 - not running
+extern struct INSTANCE *query_snap;	// of the server thread, only with -Q or -M
+
+void    query_begin();
+void    query_end();
+int     unix_listen(const char *path, int type);
+int     tcp_listen(int port);
+// one query on the socket at path, every reply packet to fn; the records received,
+// -1 on a socket error or a reply that breaks the protocol (errno EPROTO)
+long    query_request(const char *path, const oregon_query_t *q,
+		void (*fn)(const oregon_reply_t *rep, const void *recs, void *arg), void *arg);
+
+#endif /* OREGON_SERVER_H_ */
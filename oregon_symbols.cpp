@@ -0,0 +1,427 @@
+/*
+ * oregon_symbols.cpp
+ *
+ *  Created on: 17Oct.,2026
+ */
+
+#include "oregon_symbols.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SYM_HAVE_X86	1
+#include <immintrin.h>
+#else
+#define SYM_HAVE_X86	0
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SYM_HAVE_NEON	1
+#include <arm_neon.h>
+#else
+#define SYM_HAVE_NEON	0
+#endif
+
+#define SYM_TAIL	33		// padded copy for the last partial vector (+1 byte for the realign window)
+
+uint8_t oregon_sym_lut[256];
+uint8_t oregon_nibble_lut[65536];
+
+typedef struct {
+    const char *name;
+    uint8_t (*realign)(const uint8_t *src, uint8_t n, uint8_t offset_bits, uint8_t *dst);
+    void (*decode)(const uint8_t *sym, uint8_t nbytes, uint8_t *out);
+    int (*supported)(void);
+} sym_kernel_t;
+
+//------------------------------[scalar kernel]---------------------------------
+static uint8_t sym_realign_scalar(const uint8_t *src, uint8_t n, uint8_t offset_bits, uint8_t *dst)
+{
+    uint8_t i;
+
+    for(i = 0; i < n; i++)
+    {
+        dst[i] = (((src[i] << 8) + src[i+1]) >> (8 - offset_bits)) & 0xFF;
+        if (oregon_sym_lut[dst[i]] & OREGON_SYM_INVALID)
+            return i;
+    }
+    return n;
+}
+
+static void sym_decode_scalar(const uint8_t *sym, uint8_t nbytes, uint8_t *out)
+{
+    uint8_t i;
+
+    for(i = 0; i < nbytes; i++, sym += 4)
+        out[i] = (oregon_nibble_lut[(sym[0] << 8) + sym[1]] << 4) + oregon_nibble_lut[(sym[2] << 8) + sym[3]];
+}
+
+static int sym_supported_always(void)
+{
+    return 1;
+}
+//-------------------------------[end]------------------------------------------
+
+// Vector decode: a valid symbol byte has its data bits at bit 5 (first) and bit 1
+// (second). Both bit planes are gathered with a movemask, interleaved, and every
+// 8 interleaved bits give one output byte with its nibbles swapped.
+static inline uint32_t spread16(uint32_t x)
+{
+    x = (x | (x << 8)) & 0x00FF00FF;
+    x = (x | (x << 4)) & 0x0F0F0F0F;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+static inline uint64_t spread32(uint64_t x)
+{
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+    x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+    x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    x = (x | (x << 2)) & 0x3333333333333333ULL;
+    x = (x | (x << 1)) & 0x5555555555555555ULL;
+    return x;
+}
+
+static inline void sym_store_groups(uint64_t m, int groups, uint8_t *out)
+{
+    uint8_t g;
+
+    for(int k = 0; k < groups; k++, m >>= 8)
+    {
+        g = m & 0xFF;
+        out[k] = (g << 4) | (g >> 4);
+    }
+}
+
+// a chunk with an invalid lane: keep scalar semantics (dst up to and including the bad byte)
+static inline uint8_t sym_realign_bad(const uint8_t *chunk, uint8_t pos, uint32_t bad, uint8_t *dst)
+{
+    uint8_t k = __builtin_ctz(bad);
+
+    memcpy(dst + pos, chunk, k + 1);
+    return pos + k;
+}
+
+#if SYM_HAVE_X86
+//-------------------------------[SSE2 kernel]----------------------------------
+__attribute__((target("sse2")))
+static inline __m128i sse2_realign16(const uint8_t *p, __m128i cnt, uint32_t *bad)
+{
+    __m128i a = _mm_loadu_si128((const __m128i *)p), b = _mm_loadu_si128((const __m128i *)(p + 1));
+    __m128i lowb = _mm_set1_epi16(0xFF), v, ok;
+
+    v = _mm_packus_epi16(_mm_and_si128(_mm_srl_epi16(_mm_unpacklo_epi8(b, a), cnt), lowb),
+                         _mm_and_si128(_mm_srl_epi16(_mm_unpackhi_epi8(b, a), cnt), lowb));
+    ok = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8((char)0x99)), _mm_cmpeq_epi8(v, _mm_set1_epi8((char)0x96))),
+                      _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(0x69)), _mm_cmpeq_epi8(v, _mm_set1_epi8(0x66))));
+    *bad = ~_mm_movemask_epi8(ok) & 0xFFFF;
+    return v;
+}
+
+// the SSE2 loops are always inlined, so the AVX2 kernel can finish its tail with
+// them in VEX encoding (a call into legacy SSE code would pay the transition penalty)
+__attribute__((target("sse2"), always_inline))
+static inline uint8_t sse2_realign_from(int i, const uint8_t *src, uint8_t n, uint8_t offset_bits, uint8_t *dst)
+{
+    uint8_t tail[SYM_TAIL], chunk[16];
+    __m128i cnt = _mm_cvtsi32_si128(8 - offset_bits), v;
+    uint32_t bad;
+
+    // whole chunks straight from src (the last one reads src[n]), the rest from a padded copy
+    for(; i + 16 <= n; i += 16)
+    {
+        v = sse2_realign16(src + i, cnt, &bad);
+        _mm_storeu_si128((__m128i *)chunk, v);
+        if (bad)
+            return sym_realign_bad(chunk, i, bad, dst);
+        memcpy(dst + i, chunk, 16);
+    }
+    if (i == n)
+        return n;
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, src + i, n - i + 1);
+    v = sse2_realign16(tail, cnt, &bad);
+    _mm_storeu_si128((__m128i *)chunk, v);
+    bad &= (1u << (n - i)) - 1;
+    if (bad)
+        return sym_realign_bad(chunk, i, bad, dst);
+    memcpy(dst + i, chunk, n - i);
+    return n;
+}
+
+// 16 symbol bytes -> 4 output bytes; out never overtakes sym, so in-place is fine
+__attribute__((target("sse2"), always_inline))
+static inline void sse2_decode_from(int i, const uint8_t *sym, uint8_t nbytes, uint8_t *out)
+{
+    __m128i v;
+    uint32_t h, l;
+
+    for(; i + 4 <= nbytes; i += 4)
+    {
+        v = _mm_loadu_si128((const __m128i *)(sym + i * 4));
+        h = _mm_movemask_epi8(_mm_slli_epi16(v, 2));     // bit 5 -> sign bit
+        l = _mm_movemask_epi8(_mm_slli_epi16(v, 6));     // bit 1 -> sign bit
+        sym_store_groups(spread16(h) | (spread16(l) << 1), 4, out + i);
+    }
+    sym_decode_scalar(sym + i * 4, nbytes - i, out + i);
+}
+
+__attribute__((target("sse2")))
+static uint8_t sym_realign_sse2(const uint8_t *src, uint8_t n, uint8_t offset_bits, uint8_t *dst)
+{
+    return sse2_realign_from(0, src, n, offset_bits, dst);
+}
+
+__attribute__((target("sse2")))
+static void sym_decode_sse2(const uint8_t *sym, uint8_t nbytes, uint8_t *out)
+{
+    sse2_decode_from(0, sym, nbytes, out);
+}
+
+static int sym_supported_sse2(void)
+{
+    return __builtin_cpu_supports("sse2");
+}
+//-------------------------------[end]------------------------------------------
+
+//-------------------------------[AVX2 kernel]----------------------------------
+__attribute__((target("avx2")))
+static inline __m256i avx2_realign32(const uint8_t *p, __m128i cnt, uint32_t *bad)
+{
+    __m256i a = _mm256_loadu_si256((const __m256i *)p), b = _mm256_loadu_si256((const __m256i *)(p + 1));
+    __m256i lowb = _mm256_set1_epi16(0xFF), v, ok;
+
+    // unpack/pack work per 128-bit lane, so the byte order survives the round trip
+    v = _mm256_packus_epi16(_mm256_and_si256(_mm256_srl_epi16(_mm256_unpacklo_epi8(b, a), cnt), lowb),
+                            _mm256_and_si256(_mm256_srl_epi16(_mm256_unpackhi_epi8(b, a), cnt), lowb));
+    ok = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)0x99)), _mm256_cmpeq_epi8(v, _mm256_set1_epi8((char)0x96))),
+                         _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x69)), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x66))));
+    *bad = ~(uint32_t)_mm256_movemask_epi8(ok);
+    return v;
+}
+
+__attribute__((target("avx2")))
+static uint8_t sym_realign_avx2(const uint8_t *src, uint8_t n, uint8_t offset_bits, uint8_t *dst)
+{
+    uint8_t chunk[32];
+    __m128i cnt = _mm_cvtsi32_si128(8 - offset_bits);
+    uint32_t bad;
+    int i;
+
+    for(i = 0; i + 32 <= n; i += 32)
+    {
+        _mm256_storeu_si256((__m256i *)chunk, avx2_realign32(src + i, cnt, &bad));
+        if (bad)
+            return sym_realign_bad(chunk, i, bad, dst);
+        memcpy(dst + i, chunk, 32);
+    }
+    // a frame is rarely a multiple of 32 - the SSE2 loop takes the rest
+    return sse2_realign_from(i, src, n, offset_bits, dst);
+}
+
+__attribute__((target("avx2")))
+static void sym_decode_avx2(const uint8_t *sym, uint8_t nbytes, uint8_t *out)
+{
+    __m256i v;
+    uint32_t h, l;
+    int i;
+
+    for(i = 0; i + 8 <= nbytes; i += 8)
+    {
+        v = _mm256_loadu_si256((const __m256i *)(sym + i * 4));
+        h = _mm256_movemask_epi8(_mm256_slli_epi16(v, 2));
+        l = _mm256_movemask_epi8(_mm256_slli_epi16(v, 6));
+        sym_store_groups(spread32(h) | (spread32(l) << 1), 8, out + i);
+    }
+    sse2_decode_from(i, sym, nbytes, out);
+}
+
+static int sym_supported_avx2(void)
+{
+    return __builtin_cpu_supports("avx2");
+}
+//-------------------------------[end]------------------------------------------
+#endif
+
+#if SYM_HAVE_NEON
+//-------------------------------[NEON kernel]----------------------------------
+static inline uint32_t neon_movemask(uint8x16_t v)
+{
+    static const uint8_t weights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    uint64x2_t sum = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(vandq_u8(v, vld1q_u8(weights)))));
+
+    return (uint32_t)vgetq_lane_u64(sum, 0) | ((uint32_t)vgetq_lane_u64(sum, 1) << 8);
+}
+
+static inline uint8x8_t neon_realign8(uint8x8_t a, uint8x8_t b, int16x8_t shift)
+{
+    return vmovn_u16(vshlq_u16(vorrq_u16(vshll_n_u8(a, 8), vmovl_u8(b)), shift));
+}
+
+static inline uint8x16_t neon_realign16(const uint8_t *p, int16x8_t shift, uint32_t *bad)
+{
+    uint8x16_t a = vld1q_u8(p), b = vld1q_u8(p + 1), v, ok;
+
+    v = vcombine_u8(neon_realign8(vget_low_u8(a), vget_low_u8(b), shift),
+                    neon_realign8(vget_high_u8(a), vget_high_u8(b), shift));
+    ok = vorrq_u8(vorrq_u8(vceqq_u8(v, vdupq_n_u8(0x99)), vceqq_u8(v, vdupq_n_u8(0x96))),
+                  vorrq_u8(vceqq_u8(v, vdupq_n_u8(0x69)), vceqq_u8(v, vdupq_n_u8(0x66))));
+    *bad = ~neon_movemask(ok) & 0xFFFF;
+    return v;
+}
+
+static uint8_t sym_realign_neon(const uint8_t *src, uint8_t n, uint8_t offset_bits, uint8_t *dst)
+{
+    uint8_t tail[SYM_TAIL], chunk[16];
+    int16x8_t shift = vdupq_n_s16(-(int16_t)(8 - offset_bits));
+    uint32_t bad;
+    int i;
+
+    for(i = 0; i + 16 <= n; i += 16)
+    {
+        vst1q_u8(chunk, neon_realign16(src + i, shift, &bad));
+        if (bad)
+            return sym_realign_bad(chunk, i, bad, dst);
+        memcpy(dst + i, chunk, 16);
+    }
+    if (i == n)
+        return n;
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, src + i, n - i + 1);
+    vst1q_u8(chunk, neon_realign16(tail, shift, &bad));
+    bad &= (1u << (n - i)) - 1;
+    if (bad)
+        return sym_realign_bad(chunk, i, bad, dst);
+    memcpy(dst + i, chunk, n - i);
+    return n;
+}
+
+static void sym_decode_neon(const uint8_t *sym, uint8_t nbytes, uint8_t *out)
+{
+    uint8x16_t v;
+    uint32_t h, l;
+    int i;
+
+    for(i = 0; i + 4 <= nbytes; i += 4)
+    {
+        v = vld1q_u8(sym + i * 4);
+        h = neon_movemask(vtstq_u8(v, vdupq_n_u8(0x20)));
+        l = neon_movemask(vtstq_u8(v, vdupq_n_u8(0x02)));
+        sym_store_groups(spread16(h) | (spread16(l) << 1), 4, out + i);
+    }
+    sym_decode_scalar(sym + i * 4, nbytes - i, out + i);
+}
+//-------------------------------[end]------------------------------------------
+#endif
+
+// best first - a 41 byte FIFO is too short for AVX2 to pay off (see oregon_bench),
+// so it is only used when selected by name
+static const sym_kernel_t sym_kernels[] = {
+#if SYM_HAVE_X86
+    { "sse2", sym_realign_sse2, sym_decode_sse2, sym_supported_sse2 },
+    { "avx2", sym_realign_avx2, sym_decode_avx2, sym_supported_avx2 },
+#endif
+#if SYM_HAVE_NEON
+    { "neon", sym_realign_neon, sym_decode_neon, sym_supported_always },
+#endif
+    { "scalar", sym_realign_scalar, sym_decode_scalar, sym_supported_always },
+};
+#define SYM_NUM_KERNELS	(int)(sizeof(sym_kernels) / sizeof(sym_kernels[0]))
+
+static const sym_kernel_t *sym_kernel = &sym_kernels[SYM_NUM_KERNELS - 1];
+
+//------------------[lookup tables and kernel selection]------------------------
+static struct oregon_sym_tables {
+    oregon_sym_tables()
+    {
+        int i, hi, lo;
+
+        for(i = 0; i < 256; i++)
+        {
+            hi = i >> 4;
+            lo = i & 0xf;
+            if ((hi == 0x6 || hi == 0x9) && (lo == 0x6 || lo == 0x9))
+                oregon_sym_lut[i] = ((hi == 0x6) ? 1 : 0) + ((lo == 0x6) ? 2 : 0);
+            else
+                oregon_sym_lut[i] = OREGON_SYM_INVALID;
+        }
+        for(i = 0; i < 65536; i++)
+        {
+            hi = oregon_sym_lut[i >> 8];
+            lo = oregon_sym_lut[i & 0xff];
+            if ((hi | lo) & OREGON_SYM_INVALID)
+                oregon_nibble_lut[i] = OREGON_SYM_INVALID;
+            else
+                oregon_nibble_lut[i] = hi + (lo << 2);
+        }
+#if SYM_HAVE_X86
+        __builtin_cpu_init();           // needed before __builtin_cpu_supports in a constructor
+#endif
+        oregon_sym_select(0);
+    }
+} oregon_sym_tables_init;
+//-------------------------------[end]------------------------------------------
+
+int oregon_sym_select(const char *name)
+{
+    for(int i = 0; i < SYM_NUM_KERNELS; i++)
+        if ((!name || !strcmp(name, sym_kernels[i].name)) && sym_kernels[i].supported()) {
+            sym_kernel = &sym_kernels[i];
+            return 1;
+        }
+    return 0;
+}
+
+const char *oregon_sym_kernel(void)
+{
+    return sym_kernel->name;
+}
+
+//------------------------[preamble/sync correlator]----------------------------
+// 16 bits of buf starting at bit p (MSB first), needs buf[p/8 + 2]
+static inline uint32_t sync_bits16(const uint8_t *buf, int p)
+{
+    const uint8_t *b = buf + (p >> 3);
+
+    return ((((uint32_t)b[0] << 16) | (b[1] << 8) | b[2]) >> (8 - (p & 7))) & 0xFFFF;
+}
+
+uint8_t oregon_sync_find(const uint8_t *buf, uint8_t len, uint8_t &pos, uint8_t &offset_bits)
+{
+    uint32_t pre, mask;
+    int p, nbits, err;
+
+    if (len < 3)
+        return 0;
+    for(p = 0; p <= (len - 3) * 8; p++)
+    {
+        if (sync_bits16(buf, p) != OREGON_SYNC_PATTERN)
+            continue;
+        if (p >= OREGON_PREAMBLE_BITS) {
+            nbits = OREGON_PREAMBLE_BITS;
+            pre = sync_bits16(buf, p - OREGON_PREAMBLE_BITS);
+        } else {
+            nbits = p;
+            pre = (((uint32_t)buf[0] << 8) | buf[1]) >> (16 - p);
+        }
+        mask = (1u << nbits) - 1;
+        err = __builtin_popcount((pre ^ OREGON_PREAMBLE_PATTERN) & mask);
+        if (err > OREGON_PREAMBLE_MAX_ERR)
+            continue;
+        pos = p >> 3;
+        offset_bits = p & 7;
+        return 16 + nbits - err;
+    }
+    return 0;
+}
+//-------------------------------[end]------------------------------------------
+
+uint8_t oregon_sym_realign(const uint8_t *src, uint8_t n, uint8_t offset_bits, uint8_t *dst)
+{
+    return sym_kernel->realign(src, n, offset_bits, dst);
+}
+
+void oregon_sym_decode(const uint8_t *sym, uint8_t nbytes, uint8_t *out)
+{
+    sym_kernel->decode(sym, nbytes, out);
+}
@@ -0,0 +1,51 @@
+/*
+ * oregon_symbols.h
+ *
+ *  Created on: 17Oct.,2026
+ *
+ *  Symbol level of Oregon v2.1 decoding, as captured by the cc1101 without HW
+ *  manchester: every data bit is a 4-bit symbol (0 -> 1001, 1 -> 0110), so a
+ *  FIFO byte carries 2 data bits and must be one of 0x99/0x96/0x69/0x66.
+ *  Table driven (plus SSE2/AVX2/NEON kernels); the tables are filled and the kernel
+ *  picked before main(), everything is only read afterwards.
+ */
+
+#ifndef OREGON_SYMBOLS_H_
+#define OREGON_SYMBOLS_H_
+
+#include <stdint.h>
+
+#define OREGON_SYM_INVALID	0x80
+
+#define OREGON_SYNC_PATTERN		0x9696	// sync nibble 0xA (LSB first) = symbols 1001 0110 1001 0110
+#define OREGON_PREAMBLE_PATTERN	0x6666	// preamble '1' bits = symbols 0110 right before the sync
+#define OREGON_PREAMBLE_BITS	16		// preamble bits checked before a sync candidate
+#define OREGON_PREAMBLE_MAX_ERR	2		// preamble bit errors tolerated
+#define OREGON_SYNC_MAX_SCORE	(16 + OREGON_PREAMBLE_BITS)
+
+// symbol byte -> 2 data bits (bit0 = first in time), OREGON_SYM_INVALID if not a valid symbol byte
+extern uint8_t oregon_sym_lut[256];
+// symbol byte pair (first << 8 | second) -> data nibble, OREGON_SYM_INVALID if any symbol is invalid
+extern uint8_t oregon_nibble_lut[65536];
+
+// shift n symbol bytes left by offset_bits (reads src[n]), dst may equal src;
+// returns the index of the first invalid symbol byte, n if all are valid
+uint8_t oregon_sym_realign(const uint8_t *src, uint8_t n, uint8_t offset_bits, uint8_t *dst);
+// manchester and double-bit decode of valid symbol bytes: 4 symbol bytes -> 1 output byte
+// (first nibble in high half); out may equal sym as long as it does not run ahead of it
+void oregon_sym_decode(const uint8_t *sym, uint8_t nbytes, uint8_t *out);
+
+// sliding bit-level correlator for the preamble to sync transition: every bit position of
+// buf is tried, the sync symbols must match exactly and the preamble bits before them
+// (fewer at the buffer start) may have up to OREGON_PREAMBLE_MAX_ERR errors; the first
+// such position wins, as a sync pattern can also show up inside the payload.
+// Returns the score (matched sync + preamble bits), 0 if not found.
+uint8_t oregon_sync_find(const uint8_t *buf, uint8_t len, uint8_t &pos, uint8_t &offset_bits);
+
+// Both realign and decode go to a kernel picked once before main(): sse2 on x86 (avx2 on
+// request), neon when built for it on ARM, else scalar. Results are bit-identical across kernels.
+// oregon_sym_select(NULL) picks the best one again; 0 if the named one is not usable here.
+int oregon_sym_select(const char *name);
+const char *oregon_sym_kernel(void);
+
+#endif /* OREGON_SYMBOLS_H_ */